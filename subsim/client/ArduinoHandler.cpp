@@ -7,7 +7,7 @@
 
 ArduinoHandler::ArduinoHandler(uint32_t team_, uint32_t unit_)
     : EventReceiver({
-        dispatchEvent<ArduinoHandler, UnitState, &ArduinoHandler::handleUnitState>,
+        dispatchEvent<ArduinoHandler, UnitState, &ArduinoHandler::handleUnitState>(),
     })
     , team(team_)
     , unit(unit_)
@@ -157,7 +157,7 @@ void ArduinoHandler::runLoop()
                 event.team = team;
                 event.unit = unit;
                 event.desiredSpeed = cont.throttle ? 1000 : 0;
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
             }
             if (cont.steer != lastCont.steer)
             {
@@ -186,7 +186,7 @@ void ArduinoHandler::runLoop()
                     }
                     event.isPressed = false;
                 }
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
             }
             if (cont.stealth != lastCont.stealth)
             {
@@ -194,7 +194,7 @@ void ArduinoHandler::runLoop()
                 event.team = team;
                 event.unit = unit;
                 event.isStealth = !!cont.stealth;
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
             }
             if (cont.tubeArmed[tube] != lastCont.tubeArmed[tube])
             {
@@ -203,7 +203,7 @@ void ArduinoHandler::runLoop()
                 tubeArm.unit = unit;
                 tubeArm.tube = tube;
                 tubeArm.isArmed = cont.tubeArmed[tube];
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(tubeArm));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(tubeArm)));
             }
             if (cont.tubeLoadTorpedo[tube] && !lastCont.tubeLoadTorpedo[tube])
             {
@@ -212,7 +212,7 @@ void ArduinoHandler::runLoop()
                 tubeLoad.unit = unit;
                 tubeLoad.tube = tube;
                 tubeLoad.type = TubeLoadEvent::AmmoType::Torpedo;
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(tubeLoad));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(tubeLoad)));
             }
             if (cont.tubeLoadMine[tube] && !lastCont.tubeLoadMine[tube])
             {
@@ -221,14 +221,14 @@ void ArduinoHandler::runLoop()
                 tubeLoad.unit = unit;
                 tubeLoad.tube = tube;
                 tubeLoad.type = TubeLoadEvent::AmmoType::Mine;
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(tubeLoad));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(tubeLoad)));
             }
             if (cont.fire && !lastCont.fire)
             {
                 FireEvent fire;
                 fire.team = team;
                 fire.unit = unit;
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(fire));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(fire)));
                 Log::writeToLog(Log::L_DEBUG, "Fired torpedos/mines");
             }
         }
@@ -11,10 +11,10 @@
 
 HelmStation::HelmStation(uint32_t team_, uint32_t unit_, std::map<uint32_t, std::string> teamNames_)
     : EventReceiver({
-        dispatchEvent<HelmStation, KeyEvent, &HelmStation::handleKeypress>,
-        dispatchEvent<HelmStation, UnitState, &HelmStation::handleUnitState>,
-        dispatchEvent<HelmStation, IgnoreKeypresses, &HelmStation::handleMockIgnore>,
-        dispatchEvent<HelmStation, ScoreEvent, &HelmStation::handleScore>,
+        dispatchEvent<HelmStation, KeyEvent, &HelmStation::handleKeypress>(),
+        dispatchEvent<HelmStation, UnitState, &HelmStation::handleUnitState>(),
+        dispatchEvent<HelmStation, IgnoreKeypresses, &HelmStation::handleMockIgnore>(),
+        dispatchEvent<HelmStation, ScoreEvent, &HelmStation::handleScore>(),
         })
     , teamNames(teamNames_)
     , ignoringMocks(false)
@@ -54,7 +54,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
                 event.system = PowerEvent::System::Yaw;
                 event.isOn = !lastState.yawEnabled;
 
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
                 return HandleResult::Stop;
             }
 
@@ -68,7 +68,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
                 event.system = PowerEvent::System::Engine;
                 event.isOn = !lastState.engineEnabled;
 
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
                 return HandleResult::Stop;
             }
             break;
@@ -81,7 +81,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
                 event.system = PowerEvent::System::Sonar;
                 event.isOn = !lastState.sonarEnabled;
 
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
                 return HandleResult::Stop;
             }
             break;
@@ -94,7 +94,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
                 event.system = PowerEvent::System::Weapons;
                 event.isOn = !lastState.weaponsEnabled;
 
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+                eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
                 return HandleResult::Stop;
             }
             break;
@@ -117,7 +117,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
         {
             event.desiredSpeed = 0;
         }
-        EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+        eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
         return HandleResult::Stop;
     }
 
@@ -132,7 +132,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
             event.unit = unit;
             event.direction = SteeringEvent::Direction::Left;
             event.isPressed = keypress->isDown;
-            EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+            eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
 
             return HandleResult::Stop;
         }
@@ -145,7 +145,7 @@ HandleResult HelmStation::handleKeypress(KeyEvent* keypress)
             event.unit = unit;
             event.direction = SteeringEvent::Direction::Right;
             event.isPressed = keypress->isDown;
-            EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+            eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
 
             return HandleResult::Stop;
         }
@@ -45,6 +45,7 @@ public:
     KeyEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::MockUI;
     constexpr static uint32_t id = Events::MockUIEvents::Key;
+    constexpr static EventPriority priority = EventPriority::High;
 
     Key key;
     char letter;
@@ -61,6 +62,7 @@ public:
     TextInputEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::MockUI;
     constexpr static uint32_t id = Events::MockUIEvents::Text;
+    constexpr static EventPriority priority = EventPriority::High;
 
     std::string text;
 };
@@ -75,6 +77,7 @@ public:
     IgnoreKeypresses() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::MockUI;
     constexpr static uint32_t id = Events::MockUIEvents::IgnoreKeypresses;
+    constexpr static EventPriority priority = EventPriority::High;
 
     bool shouldIgnore;
 };
@@ -1,6 +1,7 @@
 #include "SimulationMaster.h"
 
 #include "MockUIEvents.h"
+#include "UI.h"
 
 #include <sstream>
 
@@ -8,9 +9,12 @@
 
 SimulationMaster::SimulationMaster(Network* network_)
     : network(network_)
+    , expectedTerrain(0)
+    , hasConfig(false)
     , EventReceiver({
-        dispatchEvent<SimulationMaster, SimulationStart, &SimulationMaster::simStart>,
-        dispatchEvent<SimulationMaster, ConfigEvent, &SimulationMaster::configData>,
+        dispatchEvent<SimulationMaster, SimulationStart, &SimulationMaster::simStart>(),
+        dispatchEvent<SimulationMaster, ConfigEvent, &SimulationMaster::configData>(),
+        dispatchEvent<SimulationMaster, TerrainData, &SimulationMaster::terrainData>(),
         })
 {
     voiceHandler.reset(new VoiceHandler);
@@ -26,20 +30,17 @@ HandleResult SimulationMaster::simStart(SimulationStart* event)
     {
         team.team = station.team;
     }
-    EventSystem::getGlobalInstance()->queueEvent(team);
+    eventSystem->queueEvent(std::move(team));
 
 
 
     Log::writeToLog(Log::INFO, "Simulation started; closing lobby.");
-    // Unhook the lobby handler and destroy it
-    //ugly hack to destroy without getting into mutex land
-    std::thread lobbyThread = std::thread(&SimulationMaster::destroyLobby, this);
-    lobbyThread.detach();
-
-    // again, hack because we can't add new callbacks inside a callback
-    std::thread createThread = std::thread(&SimulationMaster::createStations, this);
-    createThread.detach();
-
+    // Unhook the lobby handler and destroy it, then hook up the stations in its place once they can render
+    destroyLobby();
+    if (hasConfig)
+    {
+        createStations();
+    }
 
     return HandleResult::Stop;
 }
@@ -48,7 +49,54 @@ HandleResult SimulationMaster::configData(ConfigEvent* event)
 {
     Log::writeToLog(Log::L_DEBUG, "Received config data with terrain of size (",
         event->config.terrain.width, " x ", event->config.terrain.height, ")");
-    config = event->config;
+    expectedTerrain = event->terrainHash;
+    Terrain cached;
+    bool isCached = expectedTerrain == 0 || terrainCache.load(expectedTerrain, cached);
+
+    // Stations render from config, so it only changes under the redraw lock
+    {
+        std::lock_guard<std::mutex> lock(UI::getGlobalUI()->redrawMux);
+        config = event->config;
+        if (expectedTerrain != 0 && isCached)
+        {
+            config.terrain = std::move(cached);
+        }
+    }
+
+    // Snapshots can overtake the config, so stations are only created once it is here to render with
+    if (!hasConfig)
+    {
+        hasConfig = true;
+        if (!stations.empty())
+        {
+            createStations();
+        }
+    }
+
+    // Until it arrives, the terrain has its size but no cells, which render as open water
+    if (!isCached)
+    {
+        Log::writeToLog(Log::INFO, "Terrain is not cached; requesting it from the server");
+        TerrainRequest request;
+        request.hash = expectedTerrain;
+        eventSystem->queueEvent(EnvelopeMessage(std::move(request)));
+    }
+    return HandleResult::Stop;
+}
+
+HandleResult SimulationMaster::terrainData(TerrainData* event)
+{
+    if (event->hash != expectedTerrain || terrainHash(event->terrain) != expectedTerrain)
+    {
+        Log::writeToLog(Log::WARN, "Received terrain that does not match the config; ignoring it");
+        return HandleResult::Stop;
+    }
+
+    terrainCache.store(event->terrain);
+    {
+        std::lock_guard<std::mutex> lock(UI::getGlobalUI()->redrawMux);
+        config.terrain = std::move(event->terrain);
+    }
     return HandleResult::Stop;
 }
 
@@ -80,19 +128,20 @@ bool SimulationMaster::ConnectionEstablished(RakNet::RakNetGUID other)
     lobbyInit->joinLobby(other, 1);
 
     // start the theme!
-    EventSystem::getGlobalInstance()->queueEvent(ThemeAudio());
+    eventSystem->emplaceEvent<ThemeAudio>();
 
     return true;
 }
 
 bool SimulationMaster::ConnectionLost(RakNet::RakNetGUID other)
 {
+    // The server may not have our baselines any more, so start over from full states
+    unitStates.reset();
+
     // Destroy the lobby if it exists
     if (lobbyInit)
     {
-        //ugly hack to destroy without getting into mutex land
-        std::thread lobbyThread = std::thread(&SimulationMaster::destroyLobby, this);
-        lobbyThread.detach();
+        destroyLobby();
     }
     return true;
 }
@@ -3,6 +3,8 @@
 #include "../common/SimulationEvents.h"
 #include "../common/Network.h"
 #include "../common/ConfigParser.h" // for Terrain
+#include "../common/TerrainCache.h"
+#include "../common/UnitStateDelta.h"
 
 #include "LobbyHandler.h"
 #include "TacticalStation.h"
@@ -29,6 +31,9 @@ public:
     /// Handles incoming terrain data
     HandleResult configData(ConfigEvent* event);
 
+    /// Handles the terrain sent after a cache miss
+    HandleResult terrainData(TerrainData* event);
+
     /// Connection callback that is spawned when we have succesfully connected to a server. Spawns a Lobby instance
     virtual bool ConnectionEstablished(RakNet::RakNetGUID other) override;
 
@@ -39,7 +44,7 @@ private:
     /// Destroys the lobbyInit pointer.
     void destroyLobby();
 
-    /// Creates new stations once we have a station list
+    /// Creates new stations once we have a station list and the config
     void createStations();
 
     /// Stores the internal pointer to the network subsystem
@@ -66,7 +71,19 @@ private:
     /// Stores the config for this game
     Config config;
 
+    /// Terrains from earlier games, so they are only downloaded once
+    TerrainCache terrainCache;
+
+    /// Hash of the terrain the server's config named, which is the only one accepted
+    uint64_t expectedTerrain;
+
+    /// Whether the config has arrived, which stations need before they are created
+    bool hasConfig;
+
     /// Stores the team names
     std::map<uint32_t, std::string> teamNames;
+
+    /// Rebuilds UnitStates from the deltas the server sends
+    UnitStateDeltaReceiver unitStates;
 };
 
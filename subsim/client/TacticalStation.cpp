@@ -24,14 +24,14 @@ constexpr uint32_t enemyColor = rgba_to_color(255, 0, 0, 255);
 TacticalStation::TacticalStation(uint32_t team_, uint32_t unit_, Config* config_, std::map<uint32_t, std::string> teamNames_)
     : Renderable(WIDTH, HEIGHT)
     , EventReceiver({
-        dispatchEvent<TacticalStation, KeyEvent, &TacticalStation::handleKeypress>,
-        dispatchEvent<TacticalStation, TextInputEvent, &TacticalStation::handleText>,
-        dispatchEvent<TacticalStation, TextMessage, &TacticalStation::receiveTextMessage>,
-        dispatchEvent<TacticalStation, UnitState, &TacticalStation::handleUnitState>,
-        dispatchEvent<TacticalStation, SonarDisplayState, &TacticalStation::handleSonarDisplay>,
-        dispatchEvent<TacticalStation, ExplosionEvent, &TacticalStation::handleExplosion>,
-        dispatchEvent<TacticalStation, ScoreEvent, &TacticalStation::handleScores>,
-    })
+        dispatchEvent<TacticalStation, KeyEvent, &TacticalStation::handleKeypress>(),
+        dispatchEvent<TacticalStation, TextInputEvent, &TacticalStation::handleText>(),
+        dispatchEvent<TacticalStation, TextMessage, &TacticalStation::receiveTextMessage>(),
+        dispatchEvent<TacticalStation, UnitState, &TacticalStation::handleUnitState>(),
+        dispatchEvent<TacticalStation, SonarDisplayState, &TacticalStation::handleSonarDisplay>(),
+        dispatchEvent<TacticalStation, ExplosionEvent, &TacticalStation::handleExplosion>(),
+        dispatchEvent<TacticalStation, ScoreEvent, &TacticalStation::handleScores>(),
+    }, DeliveryMode::Mailbox) // Handlers wait on the UI redraw lock while a frame renders
     , team(team_)
     , unit(unit_)
     , receivingText(false)
@@ -61,7 +61,7 @@ HandleResult TacticalStation::handleKeypress(KeyEvent* keypress)
         fire.team = team;
         fire.unit = unit;
 
-        EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(fire));
+        eventSystem->queueEvent(EnvelopeMessage(std::move(fire)));
         Log::writeToLog(Log::L_DEBUG, "Fired torpedos/mines");
         return HandleResult::Stop;
     }
@@ -73,7 +73,7 @@ HandleResult TacticalStation::handleKeypress(KeyEvent* keypress)
         event.unit = unit;
         event.isStealth = !lastState.isStealth;
 
-        EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(event));
+        eventSystem->queueEvent(EnvelopeMessage(std::move(event)));
         return HandleResult::Stop;
     }
         
@@ -184,13 +184,13 @@ HandleResult TacticalStation::handleKeypress(KeyEvent* keypress)
         {
             // we armed one of the tubes, send mock along after updating state
             tubeArm.isArmed = !lastState.tubeIsArmed[tubeArm.tube];
-            EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(tubeArm));
+            eventSystem->queueEvent(EnvelopeMessage(std::move(tubeArm)));
             return HandleResult::Stop;
         }
 
         if (loaded)
         {
-            EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(tubeLoad));
+            eventSystem->queueEvent(EnvelopeMessage(std::move(tubeLoad)));
             return HandleResult::Stop;
         }
     }
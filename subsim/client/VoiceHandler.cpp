@@ -4,10 +4,10 @@
 
 VoiceHandler::VoiceHandler()
     : EventReceiver({
-        dispatchEvent<VoiceHandler, StatusUpdateEvent, &VoiceHandler::handleStatusUpdate>,
-        dispatchEvent<VoiceHandler, TeamOwnership, &VoiceHandler::handleTeamEvent>,
-        dispatchEvent<VoiceHandler, ClearAudio, &VoiceHandler::handleClearAudio>,
-        dispatchEvent<VoiceHandler, ThemeAudio, &VoiceHandler::handleTheme>,
+        dispatchEvent<VoiceHandler, StatusUpdateEvent, &VoiceHandler::handleStatusUpdate>(),
+        dispatchEvent<VoiceHandler, TeamOwnership, &VoiceHandler::handleTeamEvent>(),
+        dispatchEvent<VoiceHandler, ClearAudio, &VoiceHandler::handleClearAudio>(),
+        dispatchEvent<VoiceHandler, ThemeAudio, &VoiceHandler::handleTheme>(),
         })
 {
     SDL_AudioSpec desiredSpec;
@@ -17,16 +17,109 @@ RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::string& val)
         Log::writeToLog(Log::ERR, "Unable to deserialize string length!");
         throw NetworkMessageError("Deserialization failure!");
     }
-    char* buf = new char[len];
+    if (len > stream.GetNumberOfUnreadBits() / 8)
+    {
+        Log::writeToLog(Log::ERR, "Unable to deserialize string contents!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
 
-    if (!stream.Read(buf, len))
+    // Read straight into the string, rather than through a temporary buffer
+    val.resize(len);
+    if (len > 0 && !stream.Read(&val[0], len))
     {
         Log::writeToLog(Log::ERR, "Unable to deserialize string contents!");
         throw NetworkMessageError("Deserialization failure!");
     }
 
-    val = std::string(buf, len);
-    delete[] buf;
+    return stream;
+}
+
+uint32_t readContainerSize(RakNet::BitStream& stream, uint32_t bitsPerElement)
+{
+    uint32_t size;
+    stream >> size;
+    if (size > stream.GetNumberOfUnreadBits() / bitsPerElement)
+    {
+        Log::writeToLog(Log::ERR, "Container of ", size, " elements is larger than the rest of the message!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
+    return size;
+}
+
+/// Bits packed per WriteBits/ReadBits call
+static const size_t PackedChunkBits = 2048;
+
+void writePackedBools(RakNet::BitStream& stream, const std::vector<bool>& values)
+{
+    unsigned char buffer[PackedChunkBits / 8];
+    for (size_t start = 0; start < values.size(); start += PackedChunkBits)
+    {
+        size_t count = std::min(PackedChunkBits, values.size() - start);
+        std::fill(buffer, buffer + (count + 7) / 8, 0);
+
+        // Highest bit first, the order BitStream writes single bits in
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (values[start + i])
+            {
+                buffer[i / 8] |= 0x80 >> (i % 8);
+            }
+        }
+        // Whole bytes go through Write, which copies them directly when the stream is byte aligned
+        if (count >= 8)
+        {
+            stream.Write((const char*)buffer, count / 8);
+        }
+        if (count % 8 != 0)
+        {
+            stream.WriteBits(buffer + count / 8, count % 8, false);
+        }
+    }
+}
+
+void readPackedBools(RakNet::BitStream& stream, std::vector<bool>& values, size_t count)
+{
+    // Cleared in one go, so that only the set bits need to be stored one at a time
+    values.assign(count, false);
 
+    unsigned char buffer[PackedChunkBits / 8];
+    for (size_t start = 0; start < count; start += PackedChunkBits)
+    {
+        size_t bits = std::min(PackedChunkBits, count - start);
+        // Fewer than 8 bits skip Read, which fails on 0 bytes when the stream is not byte aligned
+        if ((bits >= 8 && !stream.Read((char*)buffer, bits / 8))
+            || (bits % 8 != 0 && !stream.ReadBits(buffer + bits / 8, bits % 8, false)))
+        {
+            Log::writeToLog(Log::ERR, "Unable to deserialize!");
+            throw NetworkMessageError("Deserialization failure!");
+        }
+        for (size_t i = 0; i < bits; i += 8)
+        {
+            if (buffer[i / 8] == 0)
+            {
+                continue;
+            }
+            for (size_t bit = i; bit < std::min(i + 8, bits); ++bit)
+            {
+                if (buffer[bit / 8] & (0x80 >> (bit % 8)))
+                {
+                    values[start + bit] = true;
+                }
+            }
+        }
+    }
+}
+
+RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::vector<bool>& vec)
+{
+    uint32_t size = vec.size();
+    stream << size;
+    writePackedBools(stream, vec);
+    return stream;
+}
+
+RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::vector<bool>& vec)
+{
+    readPackedBools(stream, vec, readContainerSize(stream, 1));
     return stream;
 }
@@ -1,7 +1,13 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "BitStream.h"
 #include "Exceptions.h"
@@ -30,13 +36,73 @@ RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::string& val)
 
 RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::string& val);
 
+/// Byte-swaps a run of values in place if the BitStream wire order differs from ours
+template <typename T>
+void swapToWireOrder(T* values, size_t count)
+{
+    if (sizeof(T) > 1 && RakNet::BitStream::DoEndianSwap())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            RakNet::BitStream::ReverseBytesInPlace((unsigned char*)&values[i], sizeof(T));
+        }
+    }
+}
+
+/// True for types that go on the wire as their raw (byte-swapped) bytes, so runs of them can be copied in bulk
+template <typename T>
+struct IsBulkField
+{
+    constexpr static bool value = (std::is_arithmetic<T>::value || std::is_enum<T>::value)
+        && !std::is_same<T, bool>::value;
+};
+
+/// Writes a run of values with a few large copies; the bytes are the same as writing each in turn
+template <typename T>
+void writeBulk(RakNet::BitStream& stream, const T* values, size_t count)
+{
+    // Swapped through a small buffer, so large runs never allocate
+    T buffer[256 / sizeof(T)];
+    const size_t chunk = sizeof(buffer) / sizeof(T);
+    for (size_t i = 0; i < count; i += chunk)
+    {
+        size_t n = std::min(chunk, count - i);
+        std::copy(values + i, values + i + n, buffer);
+        swapToWireOrder(buffer, n);
+        stream.Write((const char*)buffer, n * sizeof(T));
+    }
+}
+
+/// Reads a run of values written by writeBulk (or one at a time)
+template <typename T>
+void readBulk(RakNet::BitStream& stream, T* values, size_t count)
+{
+    // A 0 byte Read fails when the stream is not byte aligned, as inside a bundle
+    if (count > 0 && !stream.Read((char*)values, count * sizeof(T)))
+    {
+        Log::writeToLog(Log::ERR, "Unable to deserialize!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
+    swapToWireOrder(values, count);
+}
+
+/// Writes bools as one bit each, packed a buffer at a time; the bits are the same as writing each in turn
+void writePackedBools(RakNet::BitStream& stream, const std::vector<bool>& values);
+
+/// Reads count bools written by writePackedBools (or one at a time), replacing the contents of values
+void readPackedBools(RakNet::BitStream& stream, std::vector<bool>& values, size_t count);
+
+/// Reads a container size, checking the stream holds at least that many elements of the given size
+uint32_t readContainerSize(RakNet::BitStream& stream, uint32_t bitsPerElement);
+
 template<typename T>
-RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::vector<T>& vec)
+typename std::enable_if<!IsBulkField<T>::value, RakNet::BitStream&>::type
+operator<<(RakNet::BitStream& stream, const std::vector<T>& vec)
 {
     uint32_t size = vec.size();
     stream << size;
 
-    for (auto val : vec)
+    for (const T& val : vec)
     {
         stream << val;
     }
@@ -44,22 +110,46 @@ RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::vector<T>& v
 }
 
 template<typename T>
-RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::vector<T>& vec)
+typename std::enable_if<!IsBulkField<T>::value, RakNet::BitStream&>::type
+operator>>(RakNet::BitStream& stream, std::vector<T>& vec)
 {
-    uint32_t size;
-    stream >> size;
+    uint32_t size = readContainerSize(stream, 1);
 
+    vec.clear();
     vec.reserve(size);
     for (uint32_t i = 0; i < size; ++i)
     {
         T val;
         stream >> val;
-        vec.push_back(val);
+        vec.push_back(std::move(val));
     }
     
     return stream;
 }
 
+template<typename T>
+typename std::enable_if<IsBulkField<T>::value, RakNet::BitStream&>::type
+operator<<(RakNet::BitStream& stream, const std::vector<T>& vec)
+{
+    uint32_t size = vec.size();
+    stream << size;
+    writeBulk(stream, vec.data(), vec.size());
+    return stream;
+}
+
+template<typename T>
+typename std::enable_if<IsBulkField<T>::value, RakNet::BitStream&>::type
+operator>>(RakNet::BitStream& stream, std::vector<T>& vec)
+{
+    vec.resize(readContainerSize(stream, sizeof(T) * 8));
+    readBulk(stream, vec.data(), vec.size());
+    return stream;
+}
+
+RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::vector<bool>& vec);
+
+RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::vector<bool>& vec);
+
 template<typename T, typename U>
 RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::pair<T,U>& val)
 {
@@ -80,7 +170,7 @@ RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::map<T, U>& v
     uint32_t size = val.size();
     stream << size;
 
-    for (auto pair : val)
+    for (const auto& pair : val)
     {
         stream << pair.first << pair.second;
     }
@@ -90,8 +180,7 @@ RakNet::BitStream& operator<<(RakNet::BitStream& stream, const std::map<T, U>& v
 template<typename T, typename U>
 RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::map<T, U>& val)
 {
-    uint32_t size;
-    stream >> size;
+    uint32_t size = readContainerSize(stream, 1);
 
     for (uint32_t i = 0; i < size; ++i)
     {
@@ -99,7 +188,7 @@ RakNet::BitStream& operator>>(RakNet::BitStream& stream, std::map<T, U>& val)
         U value;
 
         stream >> key >> value;
-        val[key] = value;
+        val[key] = std::move(value);
     }
 
     return stream;
@@ -3,6 +3,7 @@
 #include <vector>
 #include <map>
 
+#include "EventCodec.h"
 #include "GenericParser.h"
 
 class Terrain
@@ -16,16 +17,21 @@ public:
     static constexpr uint32_t FLAG2  = 0x00FFFFFF; // cyan
     static constexpr uint32_t MINE   = 0x00FF00FF; // blue
 
+    /// RGBA colour of every pixel. Only WALL and EMPTY are sent over the network
     std::vector<uint32_t> map;
     uint32_t width;
     uint32_t height;
     uint32_t scale;
 
+    /// Colour of a cell. Outside the map is WALL; everything is EMPTY while the cells have not arrived (a terrain cache miss)
     uint32_t colorAt(int32_t tx, int32_t ty) const
     {
         if (tx < 0 || tx >= width || ty < 0 || ty >= height) {
             return WALL;
         }
+        if (map.size() < (size_t)width * height) {
+            return EMPTY;
+        }
         return map[tx+(height-1-ty)*width];
     }
     
@@ -36,6 +42,12 @@ public:
             ty * scale + scale/2
         );
     }
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.width, self.height, self.scale, runs(self.map, WALL, EMPTY));
+    }
 };
 
 class Config
@@ -72,6 +84,20 @@ public:
 
     uint16_t stealthCooldown;
     uint16_t respawnCooldown;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.terrain, self.startLocations, self.flags, self.mines,
+            self.subTurningSpeed, self.subAcceleration, self.subMaxSpeed, self.stealthSpeedLimit,
+            self.maxTorpedos, self.maxMines,
+            self.sonarRange, self.passiveSonarNoiseFloor,
+            self.torpedoSpread, self.torpedoSpeed, self.collisionRadius,
+            self.torpedoDamage, self.mineDamage, self.collisionDamage,
+            self.mineExclusionRadius,
+            self.frameMilliseconds,
+            self.stealthCooldown, self.respawnCooldown);
+    }
 };
 
 /**
@@ -3,21 +3,109 @@
 #include "EventID.h"
 
 #include "BitStreamHelper.h"
+#include "EventCodec.h"
 
 #include "Log.h"
 
-#include <sstream>
+#include <unordered_map>
 
 // Headers with actual message types
 #include "SimulationEvents.h"
 
+/// Adds the codec for event type T to the registry
+template <typename T>
+static void addCodec(std::unordered_map<uint64_t, EventCodec>& codecs)
+{
+    codecs[((uint64_t)T::category << 32) | T::id] = makeEventCodec<T>();
+}
+
 /*!
- * Definition of an ostream override so that we can easily log
- * RakNetGUID's
+ * Looks up the codec for the given event type, returning nullptr
+ * if the type is not sent over the network.
+ *
+ * To make a new event networkable, give it a field list and add it here.
  */
-static std::ostream& operator<< (std::ostream& stream, const RakNet::RakNetGUID& guid)
+static const EventCodec* findCodec(uint32_t category, uint32_t id)
 {
-    return stream << RakNet::RakNetGUID::ToUint32(guid);
+    static const std::unordered_map<uint64_t, EventCodec> codecs = []
+    {
+        std::unordered_map<uint64_t, EventCodec> codecs;
+        addCodec<SimulationStart>(codecs);
+        addCodec<UnitState>(codecs);
+        addCodec<SonarDisplayState>(codecs);
+        addCodec<ThrottleEvent>(codecs);
+        addCodec<TubeLoadEvent>(codecs);
+        addCodec<TubeArmEvent>(codecs);
+        addCodec<SteeringEvent>(codecs);
+        addCodec<FireEvent>(codecs);
+        addCodec<RangeEvent>(codecs);
+        addCodec<PowerEvent>(codecs);
+        addCodec<StealthEvent>(codecs);
+        addCodec<ExplosionEvent>(codecs);
+        addCodec<ConfigEvent>(codecs);
+        addCodec<ScoreEvent>(codecs);
+        addCodec<StatusUpdateEvent>(codecs);
+        addCodec<UnitStateDelta>(codecs);
+        addCodec<UnitStateAck>(codecs);
+        addCodec<TerrainRequest>(codecs);
+        addCodec<TerrainData>(codecs);
+        return codecs;
+    }();
+
+    auto it = codecs.find(((uint64_t)category << 32) | id);
+    return it == codecs.end() ? nullptr : &it->second;
+}
+
+/// Delivery policies of each kind of event. See EnvelopeMessage::deliveryPolicy
+static const DeliveryPolicy SnapshotPolicy{UNRELIABLE_SEQUENCED, MEDIUM_PRIORITY, Channels::Snapshots};
+static const DeliveryPolicy InputPolicy{RELIABLE_ORDERED, HIGH_PRIORITY, Channels::Inputs};
+static const DeliveryPolicy SetupPolicy{RELIABLE_ORDERED, MEDIUM_PRIORITY, Channels::Setup};
+/// Ordered on the same channel as SetupPolicy, so a config never arrives before its simulation start
+static const DeliveryPolicy BulkPolicy{RELIABLE_ORDERED, LOW_PRIORITY, Channels::Setup};
+static const DeliveryPolicy EventPolicy{RELIABLE_ORDERED, MEDIUM_PRIORITY, Channels::Events};
+
+/// Adds the delivery policy for event type T to the table
+template <typename T>
+static void addPolicy(std::unordered_map<uint64_t, DeliveryPolicy>& policies, const DeliveryPolicy& policy)
+{
+    policies[((uint64_t)T::category << 32) | T::id] = policy;
+}
+
+DeliveryPolicy EnvelopeMessage::deliveryPolicy(uint32_t category, uint32_t id)
+{
+    static const std::unordered_map<uint64_t, DeliveryPolicy> policies = []
+    {
+        std::unordered_map<uint64_t, DeliveryPolicy> policies;
+        addPolicy<UnitState>(policies, SnapshotPolicy);
+        addPolicy<UnitStateDelta>(policies, SnapshotPolicy);
+        addPolicy<UnitStateAck>(policies, SnapshotPolicy);
+        addPolicy<SonarDisplayState>(policies, SnapshotPolicy);
+        addPolicy<ScoreEvent>(policies, SnapshotPolicy);
+
+        addPolicy<ThrottleEvent>(policies, InputPolicy);
+        addPolicy<TubeLoadEvent>(policies, InputPolicy);
+        addPolicy<TubeArmEvent>(policies, InputPolicy);
+        addPolicy<SteeringEvent>(policies, InputPolicy);
+        addPolicy<FireEvent>(policies, InputPolicy);
+        addPolicy<RangeEvent>(policies, InputPolicy);
+        addPolicy<PowerEvent>(policies, InputPolicy);
+        addPolicy<StealthEvent>(policies, InputPolicy);
+        addPolicy<StatusUpdateEvent>(policies, InputPolicy);
+
+        addPolicy<SimulationStart>(policies, SetupPolicy);
+        addPolicy<ConfigEvent>(policies, BulkPolicy);
+        addPolicy<TerrainRequest>(policies, BulkPolicy);
+        addPolicy<TerrainData>(policies, BulkPolicy);
+        return policies;
+    }();
+
+    auto it = policies.find(((uint64_t)category << 32) | id);
+    return it == policies.end() ? EventPolicy : it->second;
+}
+
+DeliveryPolicy EnvelopeMessage::deliveryPolicy() const
+{
+    return event ? deliveryPolicy(event->i_category, event->i_id) : EventPolicy;
 }
 
 RakNet::MessageID EnvelopeMessage::getType() const
@@ -33,250 +121,27 @@ void EnvelopeMessage::deserialize(RakNet::BitStream& source)
 
     source >> category >> id;
 
-    switch (category)
+    EventSystem* events = destination ? destination : EventSystem::getGlobalInstance();
+    if (!deserializeEvent(category, id, source, events, address))
     {
-        case Events::Category::Simulation:
-        {
-            switch (id)
-            {
-                case Events::Sim::SimStart:
-                {
-                    SimulationStart simevent;
-                    uint32_t len;
-                    source >> len;
-
-                    std::ostringstream sstream;
-                    for (uint32_t i = 0; i < len; ++i)
-                    {
-                        SimulationStart::Station station;
-                        source >> station.team >> station.unit >> station.station;
-
-                        sstream << "(" << station.team << "," << station.unit << "," << StationNames[station.station] << ")";
-
-                        simevent.stations.push_back(station);
-                    }
-
-                    source >> simevent.teamNames;
-
-                    Log::writeToLog(Log::L_DEBUG, "Deserialized a SimStart event from node ", address, ". Responsible for stations: ", sstream.str());
-
-                        
-
-                    // inject event
-                    EventSystem::getGlobalInstance()->queueEvent(simevent);
-                }
-                break;
-
-                case Events::Sim::UnitState:
-                {
-                    UnitState us;
-                    source
-                        >> us.team >> us.unit
-                        >> us.tubeIsArmed >> us.tubeOccupancy >> us.remainingTorpedos >> us.remainingMines >> us.torpedoDistance
-                        >> us.x >> us.y >> us.depth >> us.heading >> us.direction >> us.pitch
-                        >> us.speed >> us.desiredSpeed
-                        >> us.powerAvailable >> us.powerUsage >> us.isStealth >> us.stealthCooldown
-                        >> us.respawning >> us.respawnCooldown
-                        >> us.yawEnabled >> us.pitchEnabled >> us.engineEnabled >> us.commsEnabled >> us.sonarEnabled
-                        >> us.weaponsEnabled
-                        >> us.targetIsLocked >> us.targetTeam >> us.targetUnit
-                        >> us.hasFlag >> us.flag.team >> us.flag.index;
-
-                    EventSystem::getGlobalInstance()->queueEvent(us);
-                }
-                break;
-
-                case Events::Sim::SonarDisplay:
-                {
-                    SonarDisplayState sd;
-                    uint32_t len;
-
-                    source >> len;
-                    sd.units.resize(len);
-                    for (int i = 0; i < len; ++i)
-                    {
-                        source >> sd.units[i].team >> sd.units[i].unit
-                            >> sd.units[i].x >> sd.units[i].y >> sd.units[i].depth
-                            >> sd.units[i].heading >> sd.units[i].speed >> sd.units[i].power
-                            >> sd.units[i].hasFlag
-                            >> sd.units[i].isStealth >> sd.units[i].stealthCooldown
-                            >> sd.units[i].respawning >> sd.units[i].respawnCooldown;
-                    }
-
-                    source >> len;
-                    sd.torpedos.resize(len);
-                    for (int i = 0; i < len; ++i)
-                    {
-                        source >> sd.torpedos[i].x >> sd.torpedos[i].y >> sd.torpedos[i].depth
-                            >> sd.torpedos[i].heading;
-                    }
-
-                    source >> len;
-                    sd.mines.resize(len);
-                    for (int i = 0; i < len; ++i)
-                    {
-                        source >> sd.mines[i].x >> sd.mines[i].y >> sd.mines[i].depth;
-                    }
-
-                    source >> len;
-                    sd.flags.resize(len);
-                    for (int i = 0; i < len; ++i)
-                    {
-                        source >> sd.flags[i].team >> sd.flags[i].x >> sd.flags[i].y
-                            >> sd.flags[i].depth >> sd.flags[i].isTaken;
-                    }
-
-                    EventSystem::getGlobalInstance()->queueEvent(sd);
-                }
-                break;
-
-                case Events::Sim::Throttle:
-                {
-                    ThrottleEvent te;
-                    source >> te.team >> te.unit >> te.desiredSpeed;
-
-                    EventSystem::getGlobalInstance()->queueEvent(te);
-                }
-                break;
-
-                case Events::Sim::TubeLoad:
-                {
-                    TubeLoadEvent te;
-                    source >> te.team >> te.unit >> te.tube >> te.type;
-
-                    EventSystem::getGlobalInstance()->queueEvent(te);
-                }
-                break;
-
-                case Events::Sim::TubeArm:
-                {
-                    TubeArmEvent te;
-                    source >> te.team >> te.unit >> te.tube >> te.isArmed;
-
-                    EventSystem::getGlobalInstance()->queueEvent(te);
-                }
-                break;
-
-                case Events::Sim::Steering:
-                {
-                    SteeringEvent se;
-                    source >> se.team >> se.unit >> se.direction >> se.isPressed;
-
-                    EventSystem::getGlobalInstance()->queueEvent(se);
-                }
-                break;
-
-                case Events::Sim::Fire:
-                {
-                    FireEvent fe;
-                    source >> fe.team >> fe.unit;
-
-                    EventSystem::getGlobalInstance()->queueEvent(fe);
-                }
-                break;
-
-                case Events::Sim::Range:
-                {
-                    RangeEvent re;
-                    source >> re.team >> re.unit >> re.range;
-
-                    EventSystem::getGlobalInstance()->queueEvent(re);
-                }
-                break;
-
-                case Events::Sim::Power:
-                {
-                    PowerEvent pe;
-                    source >> pe.team >> pe.unit >> pe.system >> pe.isOn;
-
-                    EventSystem::getGlobalInstance()->queueEvent(pe);
-                }
-                break;
-
-                case Events::Sim::Stealth:
-                {
-                    StealthEvent se;
-                    source >> se.team >> se.unit >> se.isStealth;
-
-                    EventSystem::getGlobalInstance()->queueEvent(se);
-                }
-                break;
-
-                case Events::Sim::Explosion:
-                {
-                    ExplosionEvent ee;
-                    source >> ee.x >> ee.y >> ee.size;
-
-                    EventSystem::getGlobalInstance()->queueEvent(ee);
-                }
-                break;
-
-                case Events::Sim::Config:
-                {
-                    ConfigEvent ce;
-                    source
-                        >> ce.config.terrain.map
-                        >> ce.config.terrain.width
-                        >> ce.config.terrain.height
-                        >> ce.config.terrain.scale
-                        >> ce.config.startLocations
-                        >> ce.config.flags
-                        >> ce.config.mines
-                        >> ce.config.subTurningSpeed
-                        >> ce.config.subAcceleration
-                        >> ce.config.subMaxSpeed 
-                        >> ce.config.stealthSpeedLimit
-                        >> ce.config.maxTorpedos
-                        >> ce.config.maxMines
-                        >> ce.config.sonarRange
-                        >> ce.config.passiveSonarNoiseFloor
-                        >> ce.config.torpedoSpread
-                        >> ce.config.torpedoSpeed
-                        >> ce.config.collisionRadius
-                        >> ce.config.torpedoDamage
-                        >> ce.config.mineDamage
-                        >> ce.config.collisionDamage
-                        >> ce.config.mineExclusionRadius
-                        >> ce.config.frameMilliseconds
-                        >> ce.config.stealthCooldown
-                        >> ce.config.respawnCooldown;
-
-                    EventSystem::getGlobalInstance()->queueEvent(ce);
-                }
-                break;
-
-                case Events::Sim::Score:
-                {
-                    ScoreEvent se;
-                    source >> se.scores;
-
-                    EventSystem::getGlobalInstance()->queueEvent(se);
-                }
-                break;
-
-                case Events::Sim::StatusUpdate:
-                {
-                    StatusUpdateEvent se;
-                    source >> se.team >> se.unit >> se.type;
-
-                    EventSystem::getGlobalInstance()->queueEvent(se);
-                }
-                break;
-
-                default:
-                Log::writeToLog(Log::ERR, "Attempted to deserialize a simulation event of id=", id, " from an envelope without deserialization code defined!");
-                throw EnvelopeError("Cannot deserialize a simulation event from an envelope.");
-            }
-        }
-        break;
-
-        default:
         Log::writeToLog(Log::ERR, "Attempted to deserialize an event of category=", category, " and id=", id, " from an envelope, but no serialization code defined!");
         throw EnvelopeError("Cannot deserialize an event into an envelope");
-        break;
     }
 }
 
+bool EnvelopeMessage::deserializeEvent(uint32_t category, uint32_t id, RakNet::BitStream& source,
+    EventSystem* events, RakNet::RakNetGUID address)
+{
+    const EventCodec* codec = findCodec(category, id);
+    if (!codec)
+    {
+        return false;
+    }
+
+    codec->decode(source, events, address);
+    return true;
+}
+
 void EnvelopeMessage::serialize(RakNet::BitStream& source) const
 {
     if (!event)
@@ -289,214 +154,122 @@ void EnvelopeMessage::serialize(RakNet::BitStream& source) const
 
     source << category << id;
 
-    switch (category)
+    if (!serializeEvent(*event, source))
     {
-        case Events::Category::Simulation:
-        {
-            switch (id)
-            {
-                case Events::Sim::SimStart:
-                {
-                    SimulationStart* simevent = (SimulationStart*)event.get();
-                    uint32_t len = simevent->stations.size();
-
-                    source << len;
-                    for (auto station : simevent->stations)
-                    {
-                        source << station.team << station.unit << station.station;
-                    }
-
-                    source << simevent->teamNames;
-                }
-                break;
-
-                case Events::Sim::UnitState:
-                {
-                    UnitState* us = (UnitState*)event.get();
-
-                    source
-                        << us->team << us->unit
-                        << us->tubeIsArmed << us->tubeOccupancy << us->remainingTorpedos << us->remainingMines << us->torpedoDistance
-                        << us->x << us->y << us->depth << us->heading << us->direction << us->pitch 
-                        << us->speed << us->desiredSpeed
-                        << us->powerAvailable << us->powerUsage << us->isStealth << us->stealthCooldown
-                        << us->respawning << us->respawnCooldown
-                        << us->yawEnabled << us->pitchEnabled << us->engineEnabled << us->commsEnabled << us->sonarEnabled
-                        << us->weaponsEnabled
-                        << us->targetIsLocked << us->targetTeam << us->targetUnit
-                        << us->hasFlag << us->flag.team << us->flag.index;
-                }
-                break;
-
-                case Events::Sim::SonarDisplay:
-                {
-                    SonarDisplayState* sd = (SonarDisplayState*)event.get();
-                    uint32_t len;
-
-                    len = sd->units.size();
-                    source << len;
-                    for (auto unit : sd->units)
-                    {
-                        source << unit.team << unit.unit
-                          << unit.x << unit.y << unit.depth
-                          << unit.heading << unit.speed << unit.power
-                          << unit.hasFlag
-                          << unit.isStealth << unit.stealthCooldown
-                          << unit.respawning << unit.respawnCooldown;
-                    }
-
-                    len = sd->torpedos.size();
-                    source << len;
-                    for (auto torp : sd->torpedos)
-                    {
-                        source << torp.x << torp.y << torp.depth << torp.heading;
-                    }
-
-                    len = sd->mines.size();
-                    source << len;
-                    for (auto mine : sd->mines)
-                    {
-                        source << mine.x << mine.y << mine.depth;
-                    }
-
-                    len = sd->flags.size();
-                    source << len;
-                    for (auto flag : sd->flags)
-                    {
-                        source << flag.team << flag.x << flag.y << flag.depth << flag.isTaken;
-                    }
-                }
-                break;
-
-                case Events::Sim::Throttle:
-                {
-                    ThrottleEvent* te = (ThrottleEvent*)event.get();
-
-                    source << te->team << te->unit << te->desiredSpeed;
-                }
-                break;
-
-                case Events::Sim::TubeLoad:
-                {
-                    TubeLoadEvent* te = (TubeLoadEvent*)event.get();
-
-                    source << te->team << te->unit << te->tube << te->type;
-                }
-                break;
-
-                case Events::Sim::TubeArm:
-                {
-                    TubeArmEvent* te = (TubeArmEvent*)event.get();
-
-                    source << te->team << te->unit << te->tube << te->isArmed;
-                }
-                break;
-
-                case Events::Sim::Steering:
-                {
-                    SteeringEvent* se = (SteeringEvent*)event.get();
-                    source << se->team << se->unit << se->direction << se->isPressed;
-                }
-                break;
-
-                case Events::Sim::Fire:
-                {
-                    FireEvent* fe = (FireEvent*)event.get();
-                    source << fe->team << fe->unit;
-                }
-                break;
-
-                case Events::Sim::Range:
-                {
-                    RangeEvent* re = (RangeEvent*)event.get();
-                    source << re->team << re->unit << re->range;
-                }
-                break;
-
-                case Events::Sim::Power:
-                {
-                    PowerEvent* pe = (PowerEvent*)event.get();
-                    source << pe->team << pe->unit << pe->system << pe->isOn;
-                }
-                break;
-
-                case Events::Sim::Stealth:
-                {
-                    StealthEvent* se = (StealthEvent*)event.get();
-                    source << se->team << se->unit << se->isStealth;
-                }
-                break;
-
-                case Events::Sim::Explosion:
-                {
-                    ExplosionEvent* ee = (ExplosionEvent*)event.get();
-                    source << ee->x << ee->y << ee->size;
-                }
-                break;
-
-                case Events::Sim::Config:
-                {
-                    ConfigEvent* ce = (ConfigEvent*)event.get();
-                    source
-                        << ce->config.terrain.map
-                        << ce->config.terrain.width
-                        << ce->config.terrain.height
-                        << ce->config.terrain.scale
-                        << ce->config.startLocations
-                        << ce->config.flags
-                        << ce->config.mines
-                        << ce->config.subTurningSpeed
-                        << ce->config.subAcceleration
-                        << ce->config.subMaxSpeed 
-                        << ce->config.stealthSpeedLimit
-                        << ce->config.maxTorpedos
-                        << ce->config.maxMines
-                        << ce->config.sonarRange
-                        << ce->config.passiveSonarNoiseFloor
-                        << ce->config.torpedoSpread
-                        << ce->config.torpedoSpeed
-                        << ce->config.collisionRadius
-                        << ce->config.torpedoDamage
-                        << ce->config.mineDamage
-                        << ce->config.collisionDamage
-                        << ce->config.mineExclusionRadius
-                        << ce->config.frameMilliseconds
-                        << ce->config.stealthCooldown
-                        << ce->config.respawnCooldown;
-                }
-                break;
-
-                case Events::Sim::Score:
-                {
-                    ScoreEvent* se = (ScoreEvent*)event.get();
-                    source << se->scores;
-                }
-                break;
-
-                case Events::Sim::StatusUpdate:
-                {
-                    StatusUpdateEvent* se = (StatusUpdateEvent*)event.get();
-                    source << se->team << se->unit << se->type;
-                }
-                break;
-
-                default:
-                Log::writeToLog(Log::ERR, "Attempted to wrap a simulation event of id=", id, " in an envelope without serialization code defined!");
-                throw EnvelopeError("Cannot serialize a simulation event into an envelope.");
-            }
-        }
-        break;
-
-        default:
         Log::writeToLog(Log::ERR, "Attempted to wrap an event of category=", category, " and id=", id, " in an envelope, but no serialization code defined!");
         throw EnvelopeError("Cannot serialize an event into an envelope");
-        break;
     }
 }
 
-EnvelopeMessage::EnvelopeMessage(RakNet::BitStream& source, RakNet::RakNetGUID address_)
-    : address(address_)
-    , Event(category, type)
+bool EnvelopeMessage::serializeEvent(const Event& event, RakNet::BitStream& source)
+{
+    const EventCodec* codec = findCodec(event.i_category, event.i_id);
+    if (!codec)
+    {
+        return false;
+    }
+
+    source.AddBitsAndReallocate(codec->estimateBits(event));
+    codec->encode(event, source);
+    return true;
+}
+
+size_t EnvelopeMessage::estimateEventBits(const Event& event)
+{
+    const EventCodec* codec = findCodec(event.i_category, event.i_id);
+    return codec ? codec->estimateBits(event) : 0;
+}
+
+EnvelopeMessage::EnvelopeMessage(RakNet::BitStream& source, RakNet::RakNetGUID address_, EventSystem* destination_)
+    : Event(category, type)
+    , address(address_)
+    , destination(destination_)
+{
+    deserialize(source);
+}
+
+/// Bits in front of each bundle entry: category, id and payload size
+constexpr static size_t BundleEntryHeaderBits = 16 + 16 + 32;
+
+EnvelopeBundle::EnvelopeBundle()
+    : count(0)
+    , policy(EventPolicy)
+    , entries(new RakNet::BitStream)
+    , destination(nullptr)
+{}
+
+EnvelopeBundle::EnvelopeBundle(RakNet::BitStream& source, RakNet::RakNetGUID address_, EventSystem* destination_)
+    : count(0)
+    , policy(EventPolicy)
+    , entries(new RakNet::BitStream)
+    , address(address_)
+    , destination(destination_)
 {
     deserialize(source);
 }
+
+EnvelopeBundle::~EnvelopeBundle() {}
+
+EnvelopeBundle::EnvelopeBundle(EnvelopeBundle&& other) = default;
+EnvelopeBundle& EnvelopeBundle::operator=(EnvelopeBundle&& other) = default;
+
+void EnvelopeBundle::append(uint32_t category, uint32_t id, RakNet::BitStream& payload)
+{
+    if (category > 0xFFFF || id > 0xFFFF || count == 0xFFFF)
+    {
+        Log::writeToLog(Log::ERR, "Cannot bundle event of category=", category, " and id=", id, " as event ", count);
+        throw EnvelopeError("Cannot add event to the bundle");
+    }
+
+    uint32_t bits = payload.GetNumberOfBitsUsed();
+    *entries << (uint16_t)category << (uint16_t)id << bits;
+    payload.ResetReadPointer();
+    entries->Write(&payload, bits);
+    ++count;
+}
+
+size_t EnvelopeBundle::bytesWith(size_t bundleBits, size_t payloadBits)
+{
+    // Message ID and count, then the entries
+    return (8 + 16 + bundleBits + BundleEntryHeaderBits + payloadBits + 7) / 8;
+}
+
+RakNet::MessageID EnvelopeBundle::getType() const
+{
+    return MessageType::ID_ENVELOPE_BUNDLE;
+}
+
+void EnvelopeBundle::serialize(RakNet::BitStream& source) const
+{
+    source << count;
+    entries->ResetReadPointer();
+    source.Write(entries.get(), entries->GetNumberOfBitsUsed());
+}
+
+void EnvelopeBundle::deserialize(RakNet::BitStream& source)
+{
+    EventSystem* events = destination ? destination : EventSystem::getGlobalInstance();
+
+    source >> count;
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        uint16_t category;
+        uint16_t id;
+        uint32_t bits;
+        source >> category >> id >> bits;
+        if (bits > source.GetNumberOfUnreadBits())
+        {
+            Log::writeToLog(Log::ERR, "Bundled event of ", bits, " bits runs past the end of the bundle!");
+            throw NetworkMessageError("Deserialization failure!");
+        }
+
+        // Always continue from the next entry, however much of this one was read
+        size_t next = source.GetReadOffset() + bits;
+        if (!EnvelopeMessage::deserializeEvent(category, id, source, events, address))
+        {
+            Log::writeToLog(Log::WARN, "Skipping bundled event of category=", category, " and id=", id,
+                " with no serialization code");
+        }
+        source.SetReadOffset(next);
+    }
+}
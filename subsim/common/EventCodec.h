@@ -0,0 +1,915 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BitStream.h"
+#include "BitStreamHelper.h"
+#include "RakNetTypes.h"
+
+#include "EventSystem.h"
+#include "Exceptions.h"
+#include "Log.h"
+
+/*!
+ * Field-list serialization.
+ *
+ * Every networked event (and every struct inside one) lists its fields once, in wire order,
+ * with a static fields() function:
+ *
+ *     template <typename Self, typename Visitor>
+ *     static void fields(Self& self, Visitor& visit)
+ *     {
+ *         visit(self.team, self.unit, self.desiredSpeed);
+ *     }
+ *
+ * FieldWriter, FieldReader and FieldSizer walk that list to encode, decode and size the
+ * event, so the wire format of every type is handled here in one place:
+ *
+ * - Arithmetic and enum fields are written with BitStream::Write (bools take one bit).
+ * - Strings, vectors, maps and pairs are written as before by BitStreamHelper: a uint32
+ *   length followed by each element.
+ * - Vectors of (non-bool) arithmetic or enum values are copied in bulk, and vector<bool>
+ *   is packed a byte at a time, with the same bits on the wire as one element at a time.
+ * - masked(value, mask) sends only the fields of a struct selected by a bitmask, which
+ *   goes on the wire first as one bit per field. See deltaMask and copyFields, which
+ *   only handle plain fields.
+ * - packed(value, bits) sends an unsigned field in the given number of bits.
+ * - position(value, axis) sends a map coordinate in just enough bits for the map size
+ *   given by an earlier bounds(width, height) field of the same message.
+ * - runs(cells, set, clear) sends a vector of cells as run lengths of cells equal to set
+ *   and cells that are not. Anything other than set comes back as clear.
+ */
+
+/// Fields of value selected by mask (bit i for the i-th listed field). Made with masked()
+template <typename T, typename M>
+struct MaskedFields
+{
+    T& value;
+    M& mask;
+};
+
+template <typename T, typename M>
+MaskedFields<T, M> masked(T& value, M& mask)
+{
+    return MaskedFields<T, M>{value, mask};
+}
+
+/// Unsigned field sent in the given number of bits, clamped to fit. Made with packed()
+template <typename T>
+struct PackedField
+{
+    T& value;
+    uint32_t bits;
+};
+
+template <typename T>
+PackedField<T> packed(T& value, uint32_t bits)
+{
+    return PackedField<T>{value, bits};
+}
+
+/// Map size in world units, which later position() fields are quantized against. Made with bounds()
+template <typename T>
+struct MapBounds
+{
+    T& width;
+    T& height;
+};
+
+template <typename T>
+MapBounds<T> bounds(T& width, T& height)
+{
+    return MapBounds<T>{width, height};
+}
+
+enum class Axis
+{
+    X = 0,
+    Y = 1
+};
+
+/// Map coordinate along an axis. Made with position()
+template <typename T>
+struct PositionField
+{
+    T& value;
+    Axis axis;
+};
+
+template <typename T>
+PositionField<T> position(T& value, Axis axis)
+{
+    return PositionField<T>{value, axis};
+}
+
+/*!
+ * Fixed-point coding of coordinates in [0, extent]. Coordinates take as many bits as
+ * extent does, up to PositionBits; beyond that the low bits are dropped. Every shipped
+ * map is small enough for coordinates to be sent exactly.
+ */
+class PositionCoding
+{
+public:
+    /// Most bits a coordinate takes on the wire
+    constexpr static uint32_t PositionBits = 16;
+
+    PositionCoding(uint32_t extent_) : extent(extent_), shift(0), bits(0)
+    {
+        if (extent == 0)
+        {
+            Log::writeToLog(Log::ERR, "Position sent without the map bounds!");
+            throw NetworkMessageError("Position sent without the map bounds");
+        }
+        while (bits < 32 && (extent >> bits) != 0)
+        {
+            ++bits;
+        }
+        if (bits > PositionBits)
+        {
+            shift = bits - PositionBits;
+            bits = PositionBits;
+        }
+    }
+
+    uint32_t encode(int64_t value) const
+    {
+        return std::max<int64_t>(0, std::min<int64_t>(value, extent)) >> shift;
+    }
+
+    int64_t decode(uint32_t code) const
+    {
+        // Land in the middle of the dropped range
+        int64_t value = ((int64_t)code << shift) + (shift ? 1ll << (shift - 1) : 0);
+        return std::min<int64_t>(value, extent);
+    }
+
+    uint32_t extent;
+    uint32_t shift;
+    uint32_t bits;
+};
+
+/// Writes the low bits of value, clamping it to the largest value that fits
+inline void writePackedBits(RakNet::BitStream& stream, uint64_t value, uint32_t bits)
+{
+    uint64_t largest = bits >= 64 ? ~0ull : (1ull << bits) - 1;
+    value = std::min(value, largest);
+
+    // Little-endian byte order, whatever the host order, as with RakNet's integer ranges
+    unsigned char bytes[8];
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        bytes[i] = (value >> (8 * i)) & 0xFF;
+    }
+    stream.WriteBits(bytes, bits, true);
+}
+
+inline uint64_t readPackedBits(RakNet::BitStream& stream, uint32_t bits)
+{
+    unsigned char bytes[8] = {0};
+    if (!stream.ReadBits(bytes, bits, true))
+    {
+        Log::writeToLog(Log::ERR, "Unable to deserialize!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/// Cells sent as runs of set and not set cells. Made with runs()
+template <typename V>
+struct RunLengthField
+{
+    V& cells;
+    typename V::value_type set;
+    typename V::value_type clear;
+};
+
+template <typename V>
+RunLengthField<V> runs(V& cells, typename V::value_type set, typename V::value_type clear)
+{
+    return RunLengthField<V>{cells, set, clear};
+}
+
+/// Most cells a runs() field may decode to, so a bad length cannot exhaust memory
+constexpr static uint32_t MaxRunLengthCells = 1 << 24;
+
+/*!
+ * Calls visit(length) for every run of cells. Runs alternate between not set and set cells,
+ * starting with a not set run, which is the only one that may be empty.
+ */
+template <typename V, typename Visit>
+void forEachRun(const RunLengthField<V>& field, Visit visit)
+{
+    bool isSet = false;
+    uint32_t run = 0;
+    for (const auto& cell : field.cells)
+    {
+        if ((cell == field.set) != isSet)
+        {
+            visit(run);
+            isSet = !isSet;
+            run = 0;
+        }
+        ++run;
+    }
+    if (run != 0)
+    {
+        visit(run);
+    }
+}
+
+/// Bits taken by a run length in Elias gamma code, which keeps short runs short
+inline uint32_t runLengthBits(uint32_t run)
+{
+    uint32_t bits = 0;
+    for (uint64_t value = (uint64_t)run + 1; value != 0; value >>= 1)
+    {
+        ++bits;
+    }
+    return 2 * bits - 1;
+}
+
+/// Writes run + 1 in Elias gamma code: as many zeros as it has bits after the first, then its bits
+inline void writeRunLength(RakNet::BitStream& stream, uint32_t run)
+{
+    uint64_t value = (uint64_t)run + 1;
+    uint32_t bits = (runLengthBits(run) + 1) / 2;
+    for (uint32_t i = 1; i < bits; ++i)
+    {
+        stream.Write(false);
+    }
+    for (uint32_t i = bits; i > 0; --i)
+    {
+        stream.Write((bool)((value >> (i - 1)) & 1));
+    }
+}
+
+/// Reads a single bit, throwing if the stream has run out
+inline bool readCodedBit(RakNet::BitStream& stream)
+{
+    bool bit;
+    if (!stream.Read(bit))
+    {
+        Log::writeToLog(Log::ERR, "Unable to deserialize!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
+    return bit;
+}
+
+inline uint32_t readRunLength(RakNet::BitStream& stream)
+{
+    uint32_t zeros = 0;
+    while (!readCodedBit(stream))
+    {
+        if (++zeros > 32)
+        {
+            Log::writeToLog(Log::ERR, "Run length does not fit in 32 bits!");
+            throw NetworkMessageError("Deserialization failure!");
+        }
+    }
+    uint64_t value = 1;
+    for (uint32_t i = 0; i < zeros; ++i)
+    {
+        value = (value << 1) | readCodedBit(stream);
+    }
+    if (value - 1 > UINT32_MAX)
+    {
+        Log::writeToLog(Log::ERR, "Run length does not fit in 32 bits!");
+        throw NetworkMessageError("Deserialization failure!");
+    }
+    return value - 1;
+}
+
+/// Counts the fields it visits
+class FieldCounter
+{
+public:
+    FieldCounter() : count(0) {}
+
+    template <typename... Ts>
+    void operator()(Ts&&...)
+    {
+        count += sizeof...(Ts);
+    }
+
+    uint32_t count;
+};
+
+/// Returns how many fields T lists
+template <typename T>
+uint32_t fieldCount(const T& value)
+{
+    FieldCounter counter;
+    T::fields(value, counter);
+    return counter.count;
+}
+
+/// Passes only the fields selected by a mask on to another visitor
+template <typename Visitor>
+class MaskedVisitor
+{
+public:
+    MaskedVisitor(Visitor& visit_, uint64_t mask_) : visit(visit_), mask(mask_), index(0) {}
+
+    template <typename... Ts>
+    void operator()(Ts&&... values)
+    {
+        int expand[] = {0, (visitIfSet(values), 0)...};
+        (void)expand;
+    }
+
+private:
+    template <typename T>
+    void visitIfSet(T& value)
+    {
+        if ((mask >> index++) & 1)
+        {
+            visit(value);
+        }
+    }
+
+    Visitor& visit;
+    uint64_t mask;
+    uint32_t index;
+};
+
+/// Collects the address of every field it visits, in order
+class FieldPointers
+{
+public:
+    FieldPointers() : count(0) {}
+
+    template <typename... Ts>
+    void operator()(const Ts&... values)
+    {
+        int expand[] = {0, (add(&values), 0)...};
+        (void)expand;
+    }
+
+    /// Most fields a masked struct may list
+    constexpr static uint32_t MaxFields = 64;
+
+    const void* pointers[MaxFields];
+    uint32_t count;
+
+private:
+    void add(const void* pointer)
+    {
+        if (count == MaxFields)
+        {
+            throw NetworkMessageError("Too many fields for a field mask");
+        }
+        pointers[count++] = pointer;
+    }
+};
+
+template <typename T>
+uint64_t deltaMask(const T& current, const T& baseline);
+
+/// Builds the mask of fields that differ from the matching fields of a baseline
+class FieldComparer
+{
+public:
+    FieldComparer(const FieldPointers& baseline_) : mask(0), baseline(baseline_), index(0) {}
+
+    template <typename... Ts>
+    void operator()(const Ts&... values)
+    {
+        int expand[] = {0, (compare(values), 0)...};
+        (void)expand;
+    }
+
+    uint64_t mask;
+
+private:
+    template <typename T>
+    void compare(const T& value)
+    {
+        if (!equal(value, *static_cast<const T*>(baseline.pointers[index])))
+        {
+            mask |= 1ull << index;
+        }
+        ++index;
+    }
+
+    template <typename T>
+    static auto equal(const T& a, const T& b) -> decltype(a == b)
+    {
+        return a == b;
+    }
+
+    /// Structs with their own field list are compared field by field
+    template <typename T>
+    static auto equal(const T& a, const T& b) -> decltype(T::fields(a, std::declval<FieldPointers&>()), bool())
+    {
+        return deltaMask(a, b) == 0;
+    }
+
+    const FieldPointers& baseline;
+    uint32_t index;
+};
+
+/// Returns the mask of fields of current that differ from baseline
+template <typename T>
+uint64_t deltaMask(const T& current, const T& baseline)
+{
+    FieldPointers pointers;
+    T::fields(baseline, pointers);
+    FieldComparer comparer(pointers);
+    T::fields(current, comparer);
+    return comparer.mask;
+}
+
+/// Assigns the fields selected by a mask from the matching fields of a source
+class FieldCopier
+{
+public:
+    FieldCopier(const FieldPointers& source_, uint64_t mask_) : source(source_), mask(mask_), index(0) {}
+
+    template <typename... Ts>
+    void operator()(Ts&... values)
+    {
+        int expand[] = {0, (copy(values), 0)...};
+        (void)expand;
+    }
+
+private:
+    template <typename T>
+    void copy(T& value)
+    {
+        if ((mask >> index) & 1)
+        {
+            value = *static_cast<const T*>(source.pointers[index]);
+        }
+        ++index;
+    }
+
+    const FieldPointers& source;
+    uint64_t mask;
+    uint32_t index;
+};
+
+/// Copies the fields selected by mask from source into target
+template <typename T>
+void copyFields(T& target, const T& source, uint64_t mask)
+{
+    FieldPointers pointers;
+    T::fields(source, pointers);
+    FieldCopier copier(pointers, mask);
+    T::fields(target, copier);
+}
+
+/// Writes the fields it visits to a BitStream
+class FieldWriter
+{
+public:
+    FieldWriter(RakNet::BitStream& stream_) : stream(stream_), extent() {}
+
+    template <typename... Ts>
+    void operator()(const Ts&... values)
+    {
+        int expand[] = {0, (write(values), 0)...};
+        (void)expand;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type write(const T& value)
+    {
+        stream.Write(value);
+    }
+
+    void write(const std::string& value)
+    {
+        stream << value;
+    }
+
+    template <typename T>
+    typename std::enable_if<IsBulkField<T>::value>::type write(const std::vector<T>& values)
+    {
+        stream << values;
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsBulkField<T>::value>::type write(const std::vector<T>& values)
+    {
+        uint32_t size = values.size();
+        stream.Write(size);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            write(values[i]);
+        }
+    }
+
+    /// vector<bool> elements are proxies, so they get their own overload
+    void write(const std::vector<bool>& values)
+    {
+        stream << values;
+    }
+
+    template <typename T, typename U>
+    void write(const std::pair<T, U>& value)
+    {
+        write(value.first);
+        write(value.second);
+    }
+
+    template <typename T, typename U>
+    void write(const std::map<T, U>& values)
+    {
+        uint32_t size = values.size();
+        stream.Write(size);
+        for (const auto& pair : values)
+        {
+            write(pair.first);
+            write(pair.second);
+        }
+    }
+
+    /// Structs with their own field list
+    template <typename T>
+    auto write(const T& value) -> decltype(T::fields(value, std::declval<FieldWriter&>()), void())
+    {
+        T::fields(value, *this);
+    }
+
+    template <typename T>
+    void write(const PackedField<T>& field)
+    {
+        writePackedBits(stream, field.value, field.bits);
+    }
+
+    template <typename T>
+    void write(const MapBounds<T>& field)
+    {
+        write(field.width);
+        write(field.height);
+        extent[0] = field.width;
+        extent[1] = field.height;
+    }
+
+    template <typename T>
+    void write(const PositionField<T>& field)
+    {
+        PositionCoding coding(extent[(int)field.axis]);
+        writePackedBits(stream, coding.encode(field.value), coding.bits);
+    }
+
+    template <typename V>
+    void write(const RunLengthField<V>& field)
+    {
+        uint32_t count = field.cells.size();
+        write(count);
+        RakNet::BitStream& out = stream;
+        forEachRun(field, [&out](uint32_t run) { writeRunLength(out, run); });
+    }
+
+    /// Fields selected by a mask, preceded by the mask itself
+    template <typename T, typename M>
+    void write(const MaskedFields<T, M>& selected)
+    {
+        uint32_t count = fieldCount(selected.value);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            stream.Write((bool)((selected.mask >> i) & 1));
+        }
+        MaskedVisitor<FieldWriter> visit(*this, selected.mask);
+        std::remove_const<T>::type::fields(selected.value, visit);
+    }
+
+private:
+    RakNet::BitStream& stream;
+
+    /// Map size set by the last bounds() field
+    uint32_t extent[2];
+};
+
+/// Reads the fields it visits from a BitStream, throwing NetworkMessageError if it runs out
+class FieldReader
+{
+public:
+    FieldReader(RakNet::BitStream& stream_) : stream(stream_), extent() {}
+
+    template <typename... Ts>
+    void operator()(Ts&&... values)
+    {
+        int expand[] = {0, (read(values), 0)...};
+        (void)expand;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type read(T& value)
+    {
+        stream >> value;
+    }
+
+    void read(std::string& value)
+    {
+        stream >> value;
+    }
+
+    template <typename T>
+    typename std::enable_if<IsBulkField<T>::value>::type read(std::vector<T>& values)
+    {
+        stream >> values;
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsBulkField<T>::value>::type read(std::vector<T>& values)
+    {
+        values.resize(readSize(1));
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            read(values[i]);
+        }
+    }
+
+    void read(std::vector<bool>& values)
+    {
+        stream >> values;
+    }
+
+    template <typename T, typename U>
+    void read(std::pair<T, U>& value)
+    {
+        read(value.first);
+        read(value.second);
+    }
+
+    template <typename T, typename U>
+    void read(std::map<T, U>& values)
+    {
+        values.clear();
+        uint32_t size = readSize(1);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            T key;
+            read(key);
+            read(values[key]);
+        }
+    }
+
+    template <typename T>
+    auto read(T& value) -> decltype(T::fields(value, std::declval<FieldReader&>()), void())
+    {
+        T::fields(value, *this);
+    }
+
+    template <typename T>
+    void read(const PackedField<T>& field)
+    {
+        field.value = readPackedBits(stream, field.bits);
+    }
+
+    template <typename T>
+    void read(const MapBounds<T>& field)
+    {
+        read(field.width);
+        read(field.height);
+        extent[0] = field.width;
+        extent[1] = field.height;
+    }
+
+    template <typename T>
+    void read(const PositionField<T>& field)
+    {
+        PositionCoding coding(extent[(int)field.axis]);
+        field.value = coding.decode(readPackedBits(stream, coding.bits));
+    }
+
+    template <typename V>
+    void read(const RunLengthField<V>& field)
+    {
+        uint32_t count;
+        read(count);
+        if (count > MaxRunLengthCells)
+        {
+            Log::writeToLog(Log::ERR, "Run-length field of ", count, " cells is too large!");
+            throw NetworkMessageError("Deserialization failure!");
+        }
+
+        field.cells.resize(count);
+        bool isSet = false;
+        uint32_t filled = 0;
+        while (filled < count)
+        {
+            uint32_t run = readRunLength(stream);
+            if (run > count - filled || (run == 0 && (filled != 0 || isSet)))
+            {
+                Log::writeToLog(Log::ERR, "Invalid run of ", run, " cells after ", filled, " of ", count, "!");
+                throw NetworkMessageError("Deserialization failure!");
+            }
+            std::fill(field.cells.begin() + filled, field.cells.begin() + filled + run,
+                isSet ? field.set : field.clear);
+            filled += run;
+            isSet = !isSet;
+        }
+    }
+
+    template <typename T, typename M>
+    void read(const MaskedFields<T, M>& selected)
+    {
+        uint32_t count = fieldCount(selected.value);
+        selected.mask = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            bool isSet;
+            stream >> isSet;
+            selected.mask |= (uint64_t)isSet << i;
+        }
+        MaskedVisitor<FieldReader> visit(*this, selected.mask);
+        T::fields(selected.value, visit);
+    }
+
+private:
+    /// Reads a container size, checking that the stream could hold that many elements of the given size
+    uint32_t readSize(size_t elementBits)
+    {
+        return readContainerSize(stream, elementBits);
+    }
+
+    RakNet::BitStream& stream;
+
+    /// Map size set by the last bounds() field
+    uint32_t extent[2];
+};
+
+/// Adds up how many bits the fields it visits take on the wire
+class FieldSizer
+{
+public:
+    FieldSizer() : bits(0), extent() {}
+
+    template <typename... Ts>
+    void operator()(const Ts&... values)
+    {
+        int expand[] = {0, (size(values), 0)...};
+        (void)expand;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type size(const T& /*value*/)
+    {
+        bits += std::is_same<T, bool>::value ? 1 : sizeof(T) * 8;
+    }
+
+    void size(const std::string& value)
+    {
+        bits += 32 + value.size() * 8;
+    }
+
+    template <typename T>
+    typename std::enable_if<IsBulkField<T>::value>::type size(const std::vector<T>& values)
+    {
+        bits += 32 + values.size() * sizeof(T) * 8;
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsBulkField<T>::value>::type size(const std::vector<T>& values)
+    {
+        bits += 32;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            size(values[i]);
+        }
+    }
+
+    void size(const std::vector<bool>& values)
+    {
+        bits += 32 + values.size();
+    }
+
+    template <typename T, typename U>
+    void size(const std::pair<T, U>& value)
+    {
+        size(value.first);
+        size(value.second);
+    }
+
+    template <typename T, typename U>
+    void size(const std::map<T, U>& values)
+    {
+        bits += 32;
+        for (const auto& pair : values)
+        {
+            size(pair.first);
+            size(pair.second);
+        }
+    }
+
+    template <typename T>
+    auto size(const T& value) -> decltype(T::fields(value, std::declval<FieldSizer&>()), void())
+    {
+        T::fields(value, *this);
+    }
+
+    template <typename T>
+    void size(const PackedField<T>& field)
+    {
+        bits += field.bits;
+    }
+
+    template <typename T>
+    void size(const MapBounds<T>& field)
+    {
+        size(field.width);
+        size(field.height);
+        extent[0] = field.width;
+        extent[1] = field.height;
+    }
+
+    template <typename T>
+    void size(const PositionField<T>& field)
+    {
+        bits += PositionCoding(extent[(int)field.axis]).bits;
+    }
+
+    template <typename V>
+    void size(const RunLengthField<V>& field)
+    {
+        size_t& total = bits;
+        total += 32;
+        forEachRun(field, [&total](uint32_t run) { total += runLengthBits(run); });
+    }
+
+    template <typename T, typename M>
+    void size(const MaskedFields<T, M>& selected)
+    {
+        bits += fieldCount(selected.value);
+        MaskedVisitor<FieldSizer> visit(*this, selected.mask);
+        std::remove_const<T>::type::fields(selected.value, visit);
+    }
+
+    size_t bits;
+
+private:
+    /// Map size set by the last bounds() field
+    uint32_t extent[2];
+};
+
+/*!
+ * Encode/decode functions for one event type, generated from its field list.
+ * Looked up by category/id in the registry in Envelope.cpp.
+ */
+struct EventCodec
+{
+    /// Writes the event's fields
+    void (*encode)(const Event& event, RakNet::BitStream& stream);
+    /// Reads an event's fields and queues it in the given EventSystem
+    void (*decode)(RakNet::BitStream& stream, EventSystem* events, RakNet::RakNetGUID address);
+    /// Returns how many bits encode will write
+    size_t (*estimateBits)(const Event& event);
+};
+
+template <typename T>
+void encodeEvent(const Event& event, RakNet::BitStream& stream)
+{
+    FieldWriter writer(stream);
+    T::fields(static_cast<const T&>(event), writer);
+}
+
+/// Events with a sender member are told which node they came from
+template <typename T>
+auto setSender(T& event, RakNet::RakNetGUID address) -> decltype(event.sender = address, void())
+{
+    event.sender = address;
+}
+
+inline void setSender(Event& /*event*/, RakNet::RakNetGUID /*address*/) {}
+
+template <typename T>
+void decodeEvent(RakNet::BitStream& stream, EventSystem* events, RakNet::RakNetGUID address)
+{
+    // Decode straight into pooled storage, reusing the capacity its containers already have
+    EventPtr event = EventPool<T>::acquire();
+    T& decoded = *static_cast<T*>(event.get());
+    FieldReader reader(stream);
+    T::fields(decoded, reader);
+    setSender(decoded, address);
+    events->queuePooledEvent<T>(std::move(event));
+}
+
+template <typename T>
+size_t estimateEventBits(const Event& event)
+{
+    FieldSizer sizer;
+    T::fields(static_cast<const T&>(event), sizer);
+    return sizer.bits;
+}
+
+/// Returns the codec for event type T
+template <typename T>
+EventCodec makeEventCodec()
+{
+    return EventCodec{&encodeEvent<T>, &decodeEvent<T>, &estimateEventBits<T>};
+}
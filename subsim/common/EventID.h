@@ -44,6 +44,10 @@ enum Sim
     Config,
     Score,
     StatusUpdate,
+    UnitStateDelta,
+    UnitStateAck,
+    TerrainRequest,
+    TerrainData,
 };
 
 } //namespace events
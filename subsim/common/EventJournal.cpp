@@ -0,0 +1,179 @@
+#include "EventJournal.h"
+
+#include "Exceptions.h"
+#include "Log.h"
+#include "Messages.h"
+
+#include "BitStream.h"
+#include "BitStreamHelper.h"
+
+/// Size of the fixed part of a record: timestamp, category, id and payload length
+constexpr static size_t RecordHeaderBytes = 8 + 4 + 4 + 4;
+
+constexpr uint32_t EventJournal::Magic;
+constexpr uint32_t EventJournal::Version;
+
+EventJournal::EventJournal(EventSystem* system_, const std::string& filename)
+    : system(system_)
+    , file(filename, std::ios::binary | std::ios::trunc)
+    , start(std::chrono::steady_clock::now())
+    , closing(false)
+    , recorded(0)
+    , skipped(0)
+{
+    if (!file)
+    {
+        Log::writeToLog(Log::ERR, "Unable to open event journal ", filename, " for writing!");
+        throw JournalError("Unable to open event journal for writing");
+    }
+
+    RakNet::BitStream header;
+    header << Magic << Version;
+    file.write((const char*)header.GetData(), header.GetNumberOfBytesUsed());
+
+    Log::writeToLog(Log::INFO, "Recording events to journal ", filename);
+    writer = std::thread(&EventJournal::runWriter, this);
+    system->setJournal(this);
+}
+
+EventJournal::~EventJournal()
+{
+    system->setJournal(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        closing = true;
+    }
+    signal.notify_one();
+    writer.join();
+    file.close();
+
+    Log::writeToLog(Log::INFO, "Event journal closed with ", recorded.load(), " events recorded, ",
+        skipped.load(), " skipped");
+}
+
+void EventJournal::record(const std::vector<EventPtr>& delivered)
+{
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        for (const EventPtr& event : delivered)
+        {
+            // Keep the event alive until the writer gets to it
+            ++event->references;
+            pending.push_back(event.get());
+        }
+    }
+    signal.notify_one();
+}
+
+uint64_t EventJournal::getRecorded() const
+{
+    return recorded.load();
+}
+
+uint64_t EventJournal::getSkipped() const
+{
+    return skipped.load();
+}
+
+void EventJournal::runWriter()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mux);
+            signal.wait(lock, [this]{ return closing || !pending.empty(); });
+            if (pending.empty())
+            {
+                return;
+            }
+            writing.swap(pending);
+        }
+
+        for (Event* event : writing)
+        {
+            writeRecord(event);
+            EventSystem::releaseEvent(event);
+        }
+        writing.clear();
+    }
+}
+
+void EventJournal::writeRecord(const Event* event)
+{
+    RakNet::BitStream payload;
+    if (!EnvelopeMessage::serializeEvent(*event, payload))
+    {
+        ++skipped;
+        return;
+    }
+
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(event->queuedAt - start).count();
+    uint64_t timestamp = micros > 0 ? micros : 0;
+    uint32_t length = payload.GetNumberOfBytesUsed();
+
+    RakNet::BitStream header;
+    header << timestamp << event->i_category << event->i_id << length;
+    file.write((const char*)header.GetData(), header.GetNumberOfBytesUsed());
+    file.write((const char*)payload.GetData(), length);
+    ++recorded;
+}
+
+uint64_t EventJournal::replay(const std::string& filename, EventSystem* events, ReplaySpeed speed)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char fileHeader[8];
+    if (!file.read(fileHeader, sizeof(fileHeader)))
+    {
+        Log::writeToLog(Log::ERR, "Unable to read event journal ", filename);
+        throw JournalError("Unable to read event journal");
+    }
+
+    uint32_t magic;
+    uint32_t version;
+    RakNet::BitStream header((unsigned char*)fileHeader, sizeof(fileHeader), false);
+    header >> magic >> version;
+    if (magic != Magic || version != Version)
+    {
+        Log::writeToLog(Log::ERR, "File ", filename, " is not a version ", Version, " event journal");
+        throw JournalError("Unsupported event journal");
+    }
+
+    uint64_t replayed = 0;
+    std::vector<char> data;
+    char recordHeader[RecordHeaderBytes];
+    auto replayStart = std::chrono::steady_clock::now();
+    while (file.read(recordHeader, RecordHeaderBytes))
+    {
+        uint64_t timestamp;
+        uint32_t category;
+        uint32_t id;
+        uint32_t length;
+        RakNet::BitStream record((unsigned char*)recordHeader, RecordHeaderBytes, false);
+        record >> timestamp >> category >> id >> length;
+
+        data.resize(length);
+        if (!file.read(data.data(), length))
+        {
+            // The recording process most likely died mid-write
+            Log::writeToLog(Log::WARN, "Event journal ", filename, " ends in a truncated record; stopping replay");
+            break;
+        }
+
+        if (speed == ReplaySpeed::WallClock)
+        {
+            std::this_thread::sleep_until(replayStart + std::chrono::microseconds(timestamp));
+        }
+
+        RakNet::BitStream payload((unsigned char*)data.data(), length, false);
+        if (!EnvelopeMessage::deserializeEvent(category, id, payload, events))
+        {
+            Log::writeToLog(Log::ERR, "Event journal ", filename, " holds an event of category=", category,
+                " and id=", id, " that cannot be deserialized!");
+            throw JournalError("Cannot replay an event from the journal");
+        }
+        ++replayed;
+    }
+
+    Log::writeToLog(Log::INFO, "Replayed ", replayed, " events from journal ", filename);
+    return replayed;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventSystem.h"
+
+/*!
+ * How fast EventJournal::replay feeds recorded events back in
+ */
+enum class ReplaySpeed
+{
+    WallClock, // Events are spaced out like they were originally queued
+    Maximum    // Events are queued back to back
+};
+
+/*!
+ * Records every event delivered by an EventSystem to a binary journal file,
+ * so real match traffic can be replayed later with EventJournal::replay.
+ *
+ * Each record holds the time the event was queued (in microseconds since the journal
+ * was opened), its category and id, and its fields as written by EnvelopeMessage.
+ * Events that cannot be put in an envelope (UI events, for example) are skipped.
+ *
+ * The delivery thread only hands events over; they are serialized and written by
+ * the journal's own writer thread.
+ */
+class EventJournal
+{
+public:
+    /// Creates (or truncates) the journal file and starts recording the given EventSystem
+    EventJournal(EventSystem* system_, const std::string& filename);
+
+    /// Stops recording, then writes out everything recorded so far
+    ~EventJournal();
+
+    /// Delete copy constructor
+    EventJournal(const EventJournal& other) = delete;
+
+    /// Delete copy assignment
+    EventJournal& operator=(const EventJournal& other) = delete;
+
+    /// Hands a pass of delivered events to the writer thread. Called by the EventSystem delivery thread.
+    void record(const std::vector<EventPtr>& delivered);
+
+    /// Returns how many events were written to the journal
+    uint64_t getRecorded() const;
+
+    /// Returns how many events were skipped, as they cannot be serialized
+    uint64_t getSkipped() const;
+
+    /**
+     * Queues every event in a journal into the given EventSystem, in recorded order.
+     * Returns the number of events queued.
+     */
+    static uint64_t replay(const std::string& filename, EventSystem* events, ReplaySpeed speed = ReplaySpeed::Maximum);
+
+private:
+    /// Writer thread: serializes and writes handed over events until the journal is closed
+    void runWriter();
+
+    /// Writes a single record to the file
+    void writeRecord(const Event* event);
+
+    /// The EventSystem being recorded
+    EventSystem* system;
+
+    /// The journal file. Writer thread only.
+    std::ofstream file;
+
+    /// Time that record timestamps are relative to
+    std::chrono::steady_clock::time_point start;
+
+    /// Events handed over but not written yet, each holding a reference. Protected by mux.
+    std::vector<Event*> pending;
+
+    /// Events being written. Writer thread only.
+    std::vector<Event*> writing;
+
+    /// Set when the writer should exit, once pending is empty. Protected by mux.
+    bool closing;
+
+    /// Protects pending and closing
+    std::mutex mux;
+
+    /// Signalled when events are handed over, or on close
+    std::condition_variable signal;
+
+    std::thread writer;
+
+    std::atomic<uint64_t> recorded;
+    std::atomic<uint64_t> skipped;
+
+    /// Identifies a journal file, followed by the format version
+    constexpr static uint32_t Magic = 0x4C4E524A; // "JRNL"
+    constexpr static uint32_t Version = 1;
+};
@@ -0,0 +1,28 @@
+#include "EventPool.h"
+
+#include "EventSystem.h"
+
+std::atomic<uint64_t> EventPoolStats::allocated(0);
+std::atomic<uint64_t> EventPoolStats::reused(0);
+std::atomic<uint64_t> EventPoolStats::recycled(0);
+std::atomic<uint64_t> EventPoolStats::released(0);
+
+EventAllocationStats EventPoolStats::get()
+{
+    EventAllocationStats stats;
+    stats.allocated = allocated.load();
+    stats.reused = reused.load();
+    stats.recycled = recycled.load();
+    stats.released = released.load();
+    return stats;
+}
+
+void EventDeleter::operator()(Event* event) const
+{
+    if (event->recycler)
+    {
+        event->recycler(event);
+    } else {
+        delete event;
+    }
+}
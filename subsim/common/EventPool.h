@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Forward declaration of Event
+class Event;
+
+/*!
+ * Deleter used for every queued event. Events that came from an EventPool are
+ * handed back to their pool for reuse, anything else is deleted.
+ */
+struct EventDeleter
+{
+    void operator()(Event* event) const;
+};
+
+/// Owning pointer to a queued event
+typedef std::unique_ptr<Event, EventDeleter> EventPtr;
+
+/// Snapshot of the event pool counters, summed over every event type
+struct EventAllocationStats
+{
+    /// Events that had to be created with new
+    uint64_t allocated;
+    /// Events handed out from a free list instead of being allocated
+    uint64_t reused;
+    /// Delivered events returned to a free list
+    uint64_t recycled;
+    /// Delivered events deleted because their free list was already full
+    uint64_t released;
+};
+
+/*!
+ * Process-wide counters shared by every EventPool, so that we can check
+ * that steady-state event traffic is not hitting the allocator.
+ */
+class EventPoolStats
+{
+public:
+    static EventAllocationStats get();
+
+    static std::atomic<uint64_t> allocated;
+    static std::atomic<uint64_t> reused;
+    static std::atomic<uint64_t> recycled;
+    static std::atomic<uint64_t> released;
+};
+
+/*!
+ * Free list of events of a single type.
+ *
+ * Delivered events are kept alive rather than deleted, and the next event of the
+ * same type is copy-assigned into one of them. Besides skipping the allocation of
+ * the event itself, this lets containers inside the event (sonar contacts, scores,
+ * ...) reuse the capacity they already have.
+ *
+ * T must be default constructible and copy assignable, like every Event.
+ * Events passed as rvalues are moved in instead, so their containers are not copied.
+ */
+template <typename T>
+class EventPool
+{
+public:
+    /**
+     * Returns a pooled event for the caller to overwrite, like a decoder does. A reused event
+     * still holds the data of its last use, so its containers keep their capacity.
+     */
+    static EventPtr acquire()
+    {
+        T* object = take();
+        if (!object)
+        {
+            object = created(new T());
+        }
+        return EventPtr(object);
+    }
+
+    /// Returns a pooled copy of the given event
+    static EventPtr acquire(const T& source)
+    {
+        T* object = take();
+        if (object)
+        {
+            *object = source;
+        } else {
+            object = created(new T(source));
+        }
+        return EventPtr(object);
+    }
+
+    /// Returns a pooled event that the given event was moved into
+    static EventPtr acquire(T&& source)
+    {
+        T* object = take();
+        if (object)
+        {
+            *object = std::move(source);
+        } else {
+            object = created(new T(std::move(source)));
+        }
+        return EventPtr(object);
+    }
+
+    /// Returns a pooled event constructed in place from the given arguments
+    template <typename... Args>
+    static EventPtr emplace(Args&&... args)
+    {
+        T* object = take();
+        if (object)
+        {
+            object->~T();
+            new (object) T(std::forward<Args>(args)...);
+            object->recycler = &EventPool<T>::recycle;
+        } else {
+            object = created(new T(std::forward<Args>(args)...));
+        }
+        return EventPtr(object);
+    }
+
+    /// Returns a delivered event to the free list. Called by EventDeleter.
+    static void recycle(Event* event)
+    {
+        EventPool& pool = instance();
+        {
+            std::lock_guard<std::mutex> lock(pool.mux);
+            if (pool.freeList.size() < MaxFree)
+            {
+                pool.freeList.push_back(static_cast<T*>(event));
+                ++EventPoolStats::recycled;
+                return;
+            }
+        }
+
+        ++EventPoolStats::released;
+        delete event;
+    }
+
+private:
+    EventPool()
+    {
+        freeList.reserve(MaxFree);
+    }
+
+    /// Pops an event off the free list, or returns nullptr if it is empty
+    static T* take()
+    {
+        EventPool& pool = instance();
+        std::lock_guard<std::mutex> lock(pool.mux);
+        if (pool.freeList.empty())
+        {
+            return nullptr;
+        }
+        T* object = pool.freeList.back();
+        pool.freeList.pop_back();
+        ++EventPoolStats::reused;
+        return object;
+    }
+
+    /// Hooks a newly allocated event up to this pool
+    static T* created(T* object)
+    {
+        object->recycler = &EventPool<T>::recycle;
+        ++EventPoolStats::allocated;
+        return object;
+    }
+
+    /// Never destroyed, so events delivered during static destruction can still be recycled
+    static EventPool& instance()
+    {
+        static EventPool* pool = new EventPool();
+        return *pool;
+    }
+
+    /// Most events of this type kept around once delivered
+    constexpr static size_t MaxFree = 256;
+
+    /// Delivered events waiting to be reused
+    std::vector<T*> freeList;
+
+    /// Protects the free list
+    std::mutex mux;
+};
@@ -0,0 +1,174 @@
+#include "EventQueue.h"
+
+#include "EventSystem.h"
+#include "Log.h"
+
+constexpr size_t EventQueue::NumLanes;
+constexpr std::array<uint32_t, EventQueue::NumLanes> EventQueue::LaneWeights;
+
+EventQueue::EventQueue(size_t capacity)
+    : credits(LaneWeights)
+    , policy(DrainPolicy::Weighted)
+    , consumerWaiting(false)
+    , closed(false)
+{
+    for (std::unique_ptr<Lane>& lane : lanes)
+    {
+        lane.reset(new Lane(capacity));
+    }
+}
+
+EventQueue::~EventQueue()
+{
+    // Reclaim anything still sitting in the rings
+    for (std::unique_ptr<Lane>& lane : lanes)
+    {
+        Event* leftover;
+        while (lane->ring.tryPop(leftover))
+        {
+            EventDeleter()(leftover);
+        }
+    }
+}
+
+void EventQueue::push(EventPtr&& event, EventPriority priority)
+{
+    Lane& lane = *lanes[static_cast<size_t>(priority)];
+    if (lane.overflowPending.load() || !lane.ring.tryPush(event.get()))
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        if (!lane.overflowPending.load())
+        {
+            Log::writeToLog(Log::WARN, "EventQueue lane ", static_cast<size_t>(priority),
+                " ring full; spilling events into the overflow queue");
+        }
+        lane.overflowPending = true;
+        lane.overflow.push_back(std::move(event));
+    } else {
+        // The ring owns the event now
+        event.release();
+    }
+
+    // Pairs with the fence in wait(): either we see the consumer waiting, or it sees our event.
+    // Only the first producer to see the consumer asleep pays for the wakeup.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting.load() && consumerWaiting.exchange(false))
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        signal.notify_one();
+    }
+}
+
+EventPtr EventQueue::popLane(Lane& lane)
+{
+    Event* event;
+    if (lane.ring.tryPop(event))
+    {
+        return EventPtr(event);
+    }
+
+    if (lane.overflowPending.load())
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        // Anything pushed to the ring before the spill started has been delivered, so the overflow is next
+        if (!lane.overflow.empty())
+        {
+            EventPtr result = std::move(lane.overflow.front());
+            lane.overflow.pop_front();
+            if (lane.overflow.empty())
+            {
+                lane.overflowPending = false;
+            }
+            return result;
+        }
+        lane.overflowPending = false;
+    }
+    return nullptr;
+}
+
+EventPtr EventQueue::pop()
+{
+    if (policy.load() == DrainPolicy::Strict)
+    {
+        for (std::unique_ptr<Lane>& lane : lanes)
+        {
+            if (EventPtr event = popLane(*lane))
+            {
+                return event;
+            }
+        }
+        return nullptr;
+    }
+
+    // Serve lanes that still have credit this round, highest first. If none of them
+    // has anything ready, start a new round so lanes that used up their credit get a turn.
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        for (size_t i = 0; i < NumLanes; ++i)
+        {
+            if (credits[i] == 0)
+            {
+                continue;
+            }
+            if (EventPtr event = popLane(*lanes[i]))
+            {
+                --credits[i];
+                return event;
+            }
+        }
+        credits = LaneWeights;
+    }
+    return nullptr;
+}
+
+void EventQueue::setDrainPolicy(DrainPolicy policy_)
+{
+    policy = policy_;
+}
+
+bool EventQueue::readable() const
+{
+    for (const std::unique_ptr<Lane>& lane : lanes)
+    {
+        if (lane->ring.readable() || lane->overflowPending.load())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventQueue::wait()
+{
+    if (closed.load())
+    {
+        return false;
+    }
+    if (readable())
+    {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mux);
+    while (true)
+    {
+        // Re-announce before every sleep, since the producer that woke us cleared the flag
+        consumerWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (closed.load() || readable())
+        {
+            break;
+        }
+        signal.wait(lock);
+    }
+    consumerWaiting = false;
+
+    return !closed.load();
+}
+
+void EventQueue::close()
+{
+    std::lock_guard<std::mutex> lock(mux);
+    closed = true;
+    signal.notify_one();
+}
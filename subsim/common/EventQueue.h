@@ -0,0 +1,222 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "EventPool.h"
+
+/*!
+ * Bounded lock-free multi-producer, single-consumer ring buffer.
+ *
+ * Each cell carries a sequence number that tells producers and the consumer
+ * whose turn it is to touch the cell, so producers only contend on a single
+ * compare-and-swap of the enqueue position and the consumer never takes a lock.
+ * Capacity must be a power of two.
+ */
+template <typename T>
+class MPSCRing
+{
+public:
+    explicit MPSCRing(size_t capacity)
+        : cells(new Cell[capacity])
+        , mask(capacity - 1)
+        , enqueuePos(0)
+        , dequeuePos(0)
+    {
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCRing(const MPSCRing& other) = delete;
+    MPSCRing& operator=(const MPSCRing& other) = delete;
+
+    /// Attempts to add a value. Safe from any thread. Returns false if the ring is full.
+    bool tryPush(const T& value)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Attempts to remove the oldest value. Consumer thread only. Returns false if nothing is ready.
+    bool tryPop(T& value)
+    {
+        Cell* cell = &cells[dequeuePos & mask];
+        if (cell->sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+        {
+            return false;
+        }
+
+        value = cell->value;
+        cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        ++dequeuePos;
+        return true;
+    }
+
+    /// Returns true if tryPop would succeed. Consumer thread only.
+    bool readable() const
+    {
+        return cells[dequeuePos & mask].sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    /// Size of a cache line on the machines the game master runs on
+    constexpr static size_t CacheLineBytes = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    const size_t mask;
+
+    /*
+     * Producer and consumer positions live on separate cache lines, from each other and from
+     * whatever is around the ring. Padded by hand rather than with alignas, since plain new does
+     * not honour alignment past alignof(std::max_align_t) before C++17, and rings are allocated
+     * with it as part of their lanes.
+     */
+    char headPadding[CacheLineBytes];
+    std::atomic<size_t> enqueuePos;
+    char positionPadding[CacheLineBytes];
+    size_t dequeuePos;
+    char tailPadding[CacheLineBytes];
+};
+
+/*!
+ * Delivery priority of an event type. Each priority has its own lane in the EventQueue.
+ */
+enum class EventPriority
+{
+    High,   // Player inputs and anything else a human is waiting on
+    Normal, // Everything not otherwise classified
+    Low,    // Periodic state snapshots, where a newer one is always on its way
+};
+
+/// How the consumer picks the next lane to take an event from
+enum class DrainPolicy
+{
+    Strict,  // Always drain higher lanes first; lower lanes wait until they are empty
+    Weighted // Take up to LaneWeights[lane] events from each lane per round, highest first
+};
+
+/*!
+ * Queue of events waiting for delivery, with any number of producers and a single consumer.
+ *
+ * Each EventPriority has its own lane. Events normally go through the lane's lock-free
+ * MPSCRing. If the ring ever fills up, producers spill into the lane's mutex-protected
+ * overflow deque (and keep using it until the consumer has drained it, so per-producer
+ * ordering is kept) instead of blocking. Events only keep their order within a lane.
+ *
+ * The consumer sleeps on a condition variable when the queue is empty. Producers only
+ * touch the mutex to wake it if it is actually asleep.
+ */
+class EventQueue
+{
+public:
+    /// Number of priority lanes
+    constexpr static size_t NumLanes = 3;
+
+    /// Events taken from each lane per round when using DrainPolicy::Weighted
+    constexpr static std::array<uint32_t, NumLanes> LaneWeights = {{8, 4, 1}};
+
+    /// Creates a queue whose lock-free rings each hold the given (power of two) number of events
+    explicit EventQueue(size_t capacity = 4096);
+
+    /// Frees any events that were never delivered
+    ~EventQueue();
+
+    /// Adds an event to the lane of the given priority. Safe from any thread.
+    void push(EventPtr&& event, EventPriority priority = EventPriority::Normal);
+
+    /**
+     * Removes the next event according to the drain policy, or returns nullptr
+     * if the queue is empty. Consumer thread only.
+     */
+    EventPtr pop();
+
+    /// Changes how pop() picks between lanes. Safe from any thread.
+    void setDrainPolicy(DrainPolicy policy);
+
+    /**
+     * Blocks the consumer until an event is available or close() is called.
+     * Returns false once the queue has been closed.
+     */
+    bool wait();
+
+    /// Wakes the consumer and makes all future wait() calls return false
+    void close();
+
+private:
+    /// Events of a single priority
+    struct Lane
+    {
+        explicit Lane(size_t capacity) : ring(capacity), overflowPending(false) {}
+
+        /// The lock-free fast path
+        MPSCRing<Event*> ring;
+
+        /// Events that did not fit in the ring, in arrival order
+        std::deque<EventPtr> overflow;
+
+        /// Set while the overflow deque is in use, so producers keep their ordering
+        std::atomic<bool> overflowPending;
+    };
+
+    /// Removes the oldest event of a single lane, or returns nullptr. Consumer thread only.
+    EventPtr popLane(Lane& lane);
+
+    /// Returns true if any lane has an event ready. Consumer thread only.
+    bool readable() const;
+
+    /// Lanes, indexed by EventPriority
+    std::array<std::unique_ptr<Lane>, NumLanes> lanes;
+
+    /// Events left to take from each lane in the current weighted round. Consumer thread only.
+    std::array<uint32_t, NumLanes> credits;
+
+    /// Current DrainPolicy
+    std::atomic<DrainPolicy> policy;
+
+    /// Protects the overflow deques and the consumer's sleep
+    std::mutex mux;
+
+    /// Signalled when an event is pushed while the consumer sleeps, or on close
+    std::condition_variable signal;
+
+    /// Set by the consumer before it sleeps
+    std::atomic<bool> consumerWaiting;
+
+    /// Set once close() has been called
+    std::atomic<bool> closed;
+};
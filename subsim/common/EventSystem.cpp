@@ -6,28 +6,61 @@
 #include "Network.h"
 #include "EventID.h"
 #include "Messages.h"
+#include "EventJournal.h"
+
+#include <algorithm>
 
 
 Event::Event(uint32_t category_, uint32_t id_)
     : i_category(category_)
     , i_id(id_)
+    , recycler(nullptr)
+    , coalescing(false)
+    , i_coalesceKey(0)
+    , references(0)
 {}
 Event::~Event() {}
 
+Event::Event(const Event& other)
+    : i_category(other.i_category)
+    , i_id(other.i_id)
+    , queuedAt(other.queuedAt)
+    , recycler(nullptr)
+    , coalescing(false)
+    , i_coalesceKey(0)
+    , references(0)
+{}
+
+Event& Event::operator=(const Event& other)
+{
+    i_category = other.i_category;
+    i_id = other.i_id;
+    queuedAt = other.queuedAt;
+    return *this;
+}
+
+
+EventReceiver::EventReceiver(std::vector<EventDispatcher> dispatchers_, DeliveryMode deliveryMode_)
+    : EventReceiver(nullptr, dispatchers_, deliveryMode_)
+{}
 
-EventReceiver::EventReceiver(std::vector<HandleResult(*)(EventReceiver*,Event*)> dispatchers_)
+EventReceiver::EventReceiver(EventSystem* eventSystem_, std::vector<EventDispatcher> dispatchers_, DeliveryMode deliveryMode_)
     : dispatchers(dispatchers_)
+    , deliveryMode(deliveryMode_)
+    , eventSystem(eventSystem_ ? eventSystem_ : EventSystem::getGlobalInstance())
 {
-    EventSystem::getGlobalInstance()->registerCallback(this);
+    eventSystem->registerCallback(this);
 }
 
     /// Removes this class from the event system
 EventReceiver::~EventReceiver()
 {
-    EventSystem::getGlobalInstance()->deregisterCallback(this);
+    eventSystem->deregisterCallback(this);
 }
 
 EventSystem* EventSystem::singleton = nullptr;
+constexpr size_t EventSystem::MailboxBatch;
+constexpr size_t EventSystem::DrainBatch;
 
 EventSystem* EventSystem::getGlobalInstance()
 {
@@ -45,28 +78,72 @@ void EventSystem::setGlobalInstance(EventSystem* system)
     singleton = system;
 }
 
-EventSystem::EventSystem(Network* network_)
-    : shutdownFlag(false)
+EventSystem::EventSystem(Network* network_, bool global_, size_t mailboxWorkers_)
+    : batchGeneration(0)
+    , passGeneration(0)
+    , coalescedDrops(0)
+    , journal(nullptr)
+    , workersStopping(false)
+    , mailboxWorkers(std::max<size_t>(1, mailboxWorkers_))
     , network(network_)
+    , global(global_)
 {
-    if (singleton != nullptr)
+    if (global)
     {
-        Log::writeToLog(Log::ERR, "Event system singleton already set to ", singleton, " when a new EventSystem was created!");
-        throw EventError("Attempted to set a new event system singleton while one was already assigned!");
+        if (singleton != nullptr)
+        {
+            Log::writeToLog(Log::ERR, "Event system singleton already set to ", singleton, " when a new EventSystem was created!");
+            throw EventError("Attempted to set a new event system singleton while one was already assigned!");
+        }
+        setGlobalInstance(this);
+    }
+
+    if (network)
+    {
+        network->setEventSystem(this);
     }
-    setGlobalInstance(this);
 
     Log::writeToLog(Log::INFO, "Starting EventSystem delivery thread...");
+    std::shared_ptr<RouteTable> table = std::make_shared<RouteTable>();
+    table->generation = 1;
+    routeTable = table;
+
+    drained.reserve(DrainBatch);
     deliveryThread = std::thread(&EventSystem::deliverEvents, this);
 }
 
 EventSystem::~EventSystem()
 {
     Log::writeToLog(Log::INFO, "Shutting down EventSystem delivery thread...");
-    shutdownFlag = true;
+    events.close();
     deliveryThread.join();
     Log::writeToLog(Log::INFO, "EventSystem delivery thread shutdown successful.");
 
+    // Workers finish whatever is left in the mailboxes before exiting
+    {
+        std::lock_guard<std::mutex> lock(runMux);
+        workersStopping = true;
+    }
+    runSignal.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    EventAllocationStats stats = getAllocationStats();
+    Log::writeToLog(Log::INFO, "Event pool stats: ", stats.allocated, " allocated, ", stats.reused, " reused, ",
+        stats.recycled, " recycled, ", stats.released, " released");
+    Log::writeToLog(Log::INFO, "Coalesced ", coalescedDrops.load(), " stale snapshots before delivery");
+
+    if (network)
+    {
+        network->setEventSystem(nullptr);
+    }
+
+    if (!global)
+    {
+        return;
+    }
     if (singleton != this)
     {
         Log::writeToLog(Log::ERR, "Attempt to deregister EventSystem:", this, " failed because the singleton value was set to ", singleton, " instead!");
@@ -78,55 +155,386 @@ EventSystem::~EventSystem()
 void EventSystem::deliverEvents()
 {
     Log::writeToLog(Log::INFO, "EventSystem delivery thread startup successful.");
-    while (true)
+    // Sleep until there is something to deliver, instead of polling the queue
+    while (events.wait())
     {
-        if (shutdownFlag == true)
+        // Take everything that is ready, so each lock below is taken once per pass instead of per event
+        while (drained.size() < DrainBatch)
         {
-            return;
+            EventPtr event = events.pop();
+            if (!event)
+            {
+                break;
+            }
+            // Our own reference, for as long as we are handing the event out
+            event->references = 1;
+            drained.push_back(std::move(event));
+        }
+        if (drained.empty())
+        {
+            continue;
+        }
+        retireSnapshots(drained);
+
+        {
+            std::lock_guard<std::mutex> lock(journalMux);
+            if (journal)
+            {
+                journal->record(drained);
+            }
         }
 
-        bool empty = false;
-        while (empty == false)
+        auto now = std::chrono::steady_clock::now();
         {
-            std::unique_ptr<Event> top_event;
+            std::lock_guard<std::mutex> lock(statsMux);
+            for (const EventPtr& event : drained)
             {
-                std::lock_guard<std::mutex> lock(queueMux);
+                latency[event->i_category].record(
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - event->queuedAt).count());
+            }
+        }
+
+        // Now deliver the events to the handlers registered for them. The whole pass uses one
+        // table, so handlers can (de)register receivers without waiting for us.
+        std::shared_ptr<const RouteTable> table = std::atomic_load(&routeTable);
+        {
+            std::lock_guard<std::mutex> lock(passMux);
+            passGeneration = table->generation;
+        }
+        if (batchGeneration != table->generation)
+        {
+            // Receivers may have gone away, so don't hold on to their batches
+            pendingBatches.clear();
+            batchGeneration = table->generation;
+        }
+
+        for (const EventPtr& event : drained)
+        {
+            routeEvent(*table, event.get());
+        }
 
-                if (events.empty())
+        for (PendingBatch& batch : pendingBatches)
+        {
+            if (!batch.events.empty())
+            {
+                if (!removedDuringPass(batch.receiver))
                 {
-                    empty = true;
-                    continue;
+                    batch.batchHandler(batch.receiver, batch.events);
                 }
+                batch.events.clear();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(passMux);
+            passGeneration = 0;
+        }
+        passDone.notify_all();
+        removedThisPass.clear();
+
+        // Mailboxes may still hold some of these; the last holder recycles them
+        for (EventPtr& event : drained)
+        {
+            releaseEvent(event.release());
+        }
+        drained.clear();
+    }
+}
+
+uint64_t EventSystem::snapshotKey(uint32_t category, uint32_t id, uint32_t coalesceKey)
+{
+    return ((uint64_t)category << 48) | ((uint64_t)(id & 0xFFFF) << 32) | coalesceKey;
+}
+
+Event* EventSystem::findPendingSnapshot(uint64_t key)
+{
+    for (const std::pair<uint64_t, Event*>& pending : pendingSnapshots)
+    {
+        if (pending.first == key)
+        {
+            return pending.second;
+        }
+    }
+    return nullptr;
+}
+
+void EventSystem::retireSnapshots(const std::vector<EventPtr>& delivering)
+{
+    bool anySnapshots = std::any_of(delivering.begin(), delivering.end(),
+        [](const EventPtr& event) { return event->coalescing; });
+    if (!anySnapshots)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(snapshotMux);
+    for (const EventPtr& event : delivering)
+    {
+        if (!event->coalescing)
+        {
+            continue;
+        }
+
+        auto pending = std::find_if(pendingSnapshots.begin(), pendingSnapshots.end(),
+            [&event](const std::pair<uint64_t, Event*>& entry) { return entry.second == event.get(); });
+        if (pending != pendingSnapshots.end())
+        {
+            *pending = pendingSnapshots.back();
+            pendingSnapshots.pop_back();
+        }
+    }
+}
+
+void EventSystem::routeEvent(const RouteTable& table, Event* event)
+{
+    auto routes = table.routes.find(dispatchKey(event->i_category, event->i_id));
+    if (routes == table.routes.end())
+    {
+        return;
+    }
 
-                top_event.swap(events.front());
-                events.pop_front();
+    // A Stop/Error result only ends propogation within that receiver
+    EventReceiver* stopped = nullptr;
+    // Routes of one receiver are adjacent, so each mailbox only gets the event once
+    Mailbox* posted = nullptr;
+    for (const DispatchRoute& route : routes->second)
+    {
+        if (route.mailbox)
+        {
+            if (route.mailbox.get() != posted)
+            {
+                posted = route.mailbox.get();
+                postToMailbox(route.mailbox, event);
             }
+            continue;
+        }
+
+        if (route.receiver == stopped || removedDuringPass(route.receiver))
+        {
+            continue;
+        }
 
-            // Now deliver the event to callbacks in the queue
+        if (route.batchHandler)
+        {
+            auto batch = std::find_if(pendingBatches.begin(), pendingBatches.end(),
+                [&route](const PendingBatch& pending)
+                { return pending.receiver == route.receiver && pending.batchHandler == route.batchHandler; });
+            if (batch == pendingBatches.end())
             {
-                std::lock_guard<std::mutex> lock(callbackMux);
+                pendingBatches.push_back(PendingBatch{route.receiver, route.batchHandler, {}});
+                batch = pendingBatches.end() - 1;
+            }
+            batch->events.push_back(event);
+            continue;
+        }
+
+        HandleResult result = route.handler(route.receiver, event);
+        if (result == HandleResult::Stop || result == HandleResult::Error)
+        {
+            stopped = route.receiver;
+        }
+    }
+}
+
+bool EventSystem::removedDuringPass(EventReceiver* receiver) const
+{
+    return !removedThisPass.empty()
+        && std::find(removedThisPass.begin(), removedThisPass.end(), receiver) != removedThisPass.end();
+}
+
+void EventSystem::waitForPass(uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(passMux);
+    passDone.wait(lock, [this, generation]{ return passGeneration == 0 || passGeneration >= generation; });
+}
+
+void EventSystem::releaseEvent(Event* event)
+{
+    if (--event->references == 0)
+    {
+        EventDeleter()(event);
+    }
+}
+
+void EventSystem::postToMailbox(const std::shared_ptr<Mailbox>& mailbox, Event* event)
+{
+    bool wasIdle;
+    Event* replaced = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mux);
+        // The receiver deregistered from a handler earlier in this pass
+        if (mailbox->closed)
+        {
+            return;
+        }
+        ++event->references;
 
-                for (EventReceiver* callback : callbacks)
+        // A stalled receiver only needs the newest of each snapshot
+        if (event->coalescing)
+        {
+            for (auto it = mailbox->pending.rbegin(); it != mailbox->pending.rend(); ++it)
+            {
+                Event* older = *it;
+                if (older->coalescing && older->i_category == event->i_category && older->i_id == event->i_id
+                    && older->i_coalesceKey == event->i_coalesceKey)
                 {
-                    HandleResult result = HandleResult::Unhandled;
-                    for (auto dispatcher : callback->dispatchers)
-                    {
-                        result = dispatcher(callback, top_event.get());
-                        if (result == HandleResult::Stop || result == HandleResult::Error)
-                        {
-                            break;
-                        }
-                    }
+                    replaced = older;
+                    *it = event;
+                    break;
                 }
             }
         }
+        if (!replaced)
+        {
+            mailbox->pending.push_back(event);
+        }
+        wasIdle = !mailbox->scheduled;
+        mailbox->scheduled = true;
+    }
+
+    if (replaced)
+    {
+        ++coalescedDrops;
+        releaseEvent(replaced);
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (wasIdle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(runMux);
+            runQueue.push_back(mailbox);
+        }
+        runSignal.notify_one();
     }
 }
 
+void EventSystem::runMailboxes()
+{
+    while (true)
+    {
+        std::shared_ptr<Mailbox> mailbox;
+        {
+            std::unique_lock<std::mutex> lock(runMux);
+            runSignal.wait(lock, [this]{ return workersStopping || !runQueue.empty(); });
+            if (runQueue.empty())
+            {
+                return;
+            }
+            mailbox = std::move(runQueue.front());
+            runQueue.pop_front();
+        }
+
+        drainMailbox(mailbox);
+    }
+}
+
+void EventSystem::drainMailbox(const std::shared_ptr<Mailbox>& mailbox)
+{
+    // Take a whole batch of events under one lock
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mux);
+        if (mailbox->closed || mailbox->pending.empty())
+        {
+            mailbox->scheduled = false;
+            mailbox->idle.notify_all();
+            return;
+        }
+        mailbox->drainer = std::this_thread::get_id();
+        auto batchEnd = mailbox->pending.begin() + std::min(MailboxBatch, mailbox->pending.size());
+        mailbox->draining.assign(mailbox->pending.begin(), batchEnd);
+        mailbox->pending.erase(mailbox->pending.begin(), batchEnd);
+    }
+
+    // A handler may deregister (and destroy) its own receiver, after which it must not be touched again
+    EventReceiver* receiver = mailbox->receiver;
+    for (Event* event : mailbox->draining)
+    {
+        for (size_t i = 0; !mailbox->closed && i < receiver->dispatchers.size(); ++i)
+        {
+            const EventDispatcher& dispatcher = receiver->dispatchers[i];
+            if (dispatcher.category != event->i_category || dispatcher.id != event->i_id)
+            {
+                continue;
+            }
+
+            if (dispatcher.batchHandler)
+            {
+                mailbox->batches[i].push_back(event);
+                continue;
+            }
+
+            HandleResult result = dispatcher.handler(receiver, event);
+            if (result == HandleResult::Stop || result == HandleResult::Error)
+            {
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < mailbox->batches.size(); ++i)
+    {
+        if (!mailbox->batches[i].empty())
+        {
+            if (!mailbox->closed)
+            {
+                receiver->dispatchers[i].batchHandler(receiver, mailbox->batches[i]);
+            }
+            mailbox->batches[i].clear();
+        }
+    }
+
+    for (Event* event : mailbox->draining)
+    {
+        releaseEvent(event);
+    }
+    mailbox->draining.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mux);
+        mailbox->drainer = std::thread::id();
+        if (mailbox->closed || mailbox->pending.empty())
+        {
+            mailbox->scheduled = false;
+            mailbox->idle.notify_all();
+            return;
+        }
+    }
+
+    // Still busy: go to the back of the run queue so other receivers get a turn
+    {
+        std::lock_guard<std::mutex> lock(runMux);
+        runQueue.push_back(mailbox);
+    }
+    runSignal.notify_one();
+}
+
+LatencySummary EventSystem::getLatencySummary(uint32_t category)
+{
+    std::lock_guard<std::mutex> lock(statsMux);
+    auto it = latency.find(category);
+    if (it == latency.end())
+    {
+        return LatencyHistogram().summary();
+    }
+    return it->second.summary();
+}
+
+void EventSystem::resetLatencyStats()
+{
+    std::lock_guard<std::mutex> lock(statsMux);
+    latency.clear();
+}
 
+void EventSystem::setJournal(EventJournal* journal_)
+{
+    std::lock_guard<std::mutex> lock(journalMux);
+    journal = journal_;
+}
 
+uint64_t EventSystem::dispatchKey(uint32_t category, uint32_t id)
+{
+    return ((uint64_t)category << 32) | id;
+}
 
 void EventSystem::registerCallback(EventReceiver* callback)
 {
@@ -134,50 +542,178 @@ void EventSystem::registerCallback(EventReceiver* callback)
     if (callbacks.insert(callback).second == false)
     {
         Log::writeToLog(Log::WARN, "Event callback class ", callback, " already registered! Ignoring.");
-    } else {
-        Log::writeToLog(Log::L_DEBUG, "Registered event callback class ", callback);
+        return;
     }
-}
 
-void EventSystem::deregisterCallback(EventReceiver* callback)
-{
-    std::lock_guard<std::mutex> lock(callbackMux);
-    auto it = callbacks.find(callback);
+    std::shared_ptr<Mailbox> mailbox;
+    if (callback->deliveryMode == DeliveryMode::Mailbox)
+    {
+        mailbox = std::make_shared<Mailbox>();
+        mailbox->receiver = callback;
+        mailbox->scheduled = false;
+        mailbox->closed = false;
+        mailbox->batches.resize(callback->dispatchers.size());
+        mailboxes[callback] = mailbox;
+
+        if (workers.empty())
+        {
+            Log::writeToLog(Log::INFO, "Starting ", mailboxWorkers, " EventSystem mailbox workers...");
+            for (size_t i = 0; i < mailboxWorkers; ++i)
+            {
+                workers.emplace_back(&EventSystem::runMailboxes, this);
+            }
+        }
+    }
 
-    if (it == callbacks.end())
+    std::shared_ptr<RouteTable> table = std::make_shared<RouteTable>(*std::atomic_load(&routeTable));
+    for (const EventDispatcher& dispatcher : callback->dispatchers)
     {
-        Log::writeToLog(Log::ERR, "Attempted to remove event callback ", callback, " that was not registered!");
-        throw EventError("Removal of unregistered event callback attempted!");
+        std::vector<DispatchRoute>& routes = table->routes[dispatchKey(dispatcher.category, dispatcher.id)];
+        // Insert after any routes of receivers that sort before (or equal to) us,
+        // so that our own handlers stay in the order they were declared
+        auto position = std::upper_bound(routes.begin(), routes.end(), callback,
+            [](EventReceiver* receiver, const DispatchRoute& route) { return receiver < route.receiver; });
+        routes.insert(position, DispatchRoute{callback, dispatcher.handler, dispatcher.batchHandler, mailbox});
     }
+    publishRoutes(table);
 
-    callbacks.erase(it);
+    Log::writeToLog(Log::L_DEBUG, "Registered event callback class ", callback);
+}
 
-    Log::writeToLog(Log::L_DEBUG, "Deregistered event system callback class ", callback);
+void EventSystem::publishRoutes(const std::shared_ptr<RouteTable>& table)
+{
+    ++table->generation;
+    std::atomic_store(&routeTable, std::shared_ptr<const RouteTable>(table));
 }
 
-void EventSystem::internalQueueEvent(std::unique_ptr<Event>&& event)
+void EventSystem::deregisterCallback(EventReceiver* callback)
 {
-    // Check if this is an envelope event. If so, pass it through the network
-    if (event->i_category == Events::Network && event->i_id == Events::Net::Envelope)
+    std::shared_ptr<Mailbox> mailbox;
+    uint64_t generation;
     {
-        EnvelopeMessage* message = (EnvelopeMessage*)event.get();
+        std::lock_guard<std::mutex> lock(callbackMux);
+        auto it = callbacks.find(callback);
+
+        if (it == callbacks.end())
+        {
+            Log::writeToLog(Log::ERR, "Attempted to remove event callback ", callback, " that was not registered!");
+            throw EventError("Removal of unregistered event callback attempted!");
+        }
+
+        callbacks.erase(it);
 
-        if (!network)
+        std::shared_ptr<RouteTable> table = std::make_shared<RouteTable>(*std::atomic_load(&routeTable));
+        for (const EventDispatcher& dispatcher : callback->dispatchers)
         {
-            Log::writeToLog(Log::ERR, "Attempted to deliver an envelope when no network setup!");
-            throw EventError("Attempted to deliver an envelope without an active network!");
+            auto routes = table->routes.find(dispatchKey(dispatcher.category, dispatcher.id));
+            if (routes == table->routes.end())
+            {
+                continue;
+            }
+
+            routes->second.erase(std::remove_if(routes->second.begin(), routes->second.end(),
+                [callback](const DispatchRoute& route) { return route.receiver == callback; }),
+                routes->second.end());
+
+            if (routes->second.empty())
+            {
+                table->routes.erase(routes);
+            }
         }
-        RakNet::RakNetGUID destination = message->address;
-        if (destination == RakNet::UNASSIGNED_RAKNET_GUID)
+        publishRoutes(table);
+        generation = table->generation;
+
+        auto box = mailboxes.find(callback);
+        if (box != mailboxes.end())
         {
-            destination = network->getFirstConnectionGUID();
+            mailbox = box->second;
+            mailboxes.erase(box);
         }
-        network->sendMessage(destination, message, PacketReliability::RELIABLE_SEQUENCED);
     }
 
-    std::lock_guard<std::mutex> lock(queueMux);
-    events.push_back(std::move(event));
+    // A pass that started with the old table may still call our inline handlers. If we are
+    // inside one of them, the rest of the pass skips us instead; otherwise wait for it to end.
+    if (std::this_thread::get_id() == deliveryThread.get_id())
+    {
+        removedThisPass.push_back(callback);
+    }
+    else
+    {
+        waitForPass(generation);
+    }
+
+    // No new events can reach the mailbox once it is closed. Wait for a worker that is still
+    // handling one of our events (unless that is us), then drop the rest.
+    if (mailbox)
+    {
+        std::unique_lock<std::mutex> lock(mailbox->mux);
+        mailbox->closed = true;
+        if (mailbox->drainer != std::this_thread::get_id())
+        {
+            mailbox->idle.wait(lock, [&mailbox]{ return !mailbox->scheduled; });
+        }
+        for (Event* event : mailbox->pending)
+        {
+            releaseEvent(event);
+        }
+        mailbox->pending.clear();
+    }
+
+    Log::writeToLog(Log::L_DEBUG, "Deregistered event system callback class ", callback);
 }
 
+EventAllocationStats EventSystem::getAllocationStats()
+{
+    return EventPoolStats::get();
+}
+
+void EventSystem::queueEvent(const EnvelopeMessage& envelope)
+{
+    if (!network)
+    {
+        Log::writeToLog(Log::ERR, "Attempted to deliver an envelope when no network setup!");
+        throw EventError("Attempted to deliver an envelope without an active network!");
+    }
+    RakNet::RakNetGUID destination = envelope.address;
+    if (destination == RakNet::UNASSIGNED_RAKNET_GUID)
+    {
+        destination = network->getFirstConnectionGUID();
+    }
+    network->sendMessage(destination, &envelope, envelope.deliveryPolicy());
+}
 
-    
+void EventSystem::queueBroadcast(const EnvelopeMessage& envelope, const std::set<RakNet::RakNetGUID>& destinations)
+{
+    if (!network)
+    {
+        Log::writeToLog(Log::ERR, "Attempted to broadcast an envelope when no network setup!");
+        throw EventError("Attempted to broadcast an envelope without an active network!");
+    }
+    network->broadcastMessage(destinations, &envelope, envelope.deliveryPolicy());
+}
+
+void EventSystem::queueBundle(const EnvelopeBundle& bundle, RakNet::RakNetGUID destination)
+{
+    if (!network)
+    {
+        Log::writeToLog(Log::ERR, "Attempted to deliver a bundle when no network setup!");
+        throw EventError("Attempted to deliver a bundle without an active network!");
+    }
+    network->sendMessage(destination, &bundle, bundle.policy);
+}
+
+uint64_t EventSystem::getCoalescedDrops() const
+{
+    return coalescedDrops.load();
+}
+
+void EventSystem::setDrainPolicy(DrainPolicy policy)
+{
+    events.setDrainPolicy(policy);
+}
+
+void EventSystem::internalQueueEvent(EventPtr&& event, EventPriority priority)
+{
+    event->queuedAt = std::chrono::steady_clock::now();
+    events.push(std::move(event), priority);
+}
@@ -1,17 +1,41 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
-#include <vector>
 #include <deque>
+#include <vector>
+#include <map>
 #include <set>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "RakNetTypes.h" // For RakNetGUID
+
+#include "EventPool.h"
+#include "EventQueue.h"
+#include "LatencyHistogram.h"
 
 /// Forward declaration of Network
 class Network;
 
+/// Forward declaration of EnvelopeMessage
+struct EnvelopeMessage;
+
+/// Forward declaration of EnvelopeBundle
+struct EnvelopeBundle;
+
+/// Forward declaration of EventSystem
+class EventSystem;
+
+/// Forward declaration of EventJournal
+class EventJournal;
+
 /*!
  * Class from which Events all inherit from. Note that because
  * events are stored polymorphically by the EventSystem, your
@@ -27,6 +51,12 @@ class Event
     Event(uint32_t category_, uint32_t id_);
     virtual ~Event();
 
+    /// Copies the event data. The copy does not belong to any EventPool.
+    Event(const Event& other);
+
+    /// Copies the event data, leaving the pool this event belongs to unchanged
+    Event& operator=(const Event& other);
+
     /// Stores the broad category of the event
     constexpr static uint32_t category = 0;
 
@@ -36,11 +66,44 @@ class Event
      */
     constexpr static uint32_t id = 0;
 
+    /**
+     * Stores the delivery priority of the event type, which picks its EventQueue lane.
+     * Event types hide this with their own value to change lanes.
+     */
+    constexpr static EventPriority priority = EventPriority::Normal;
+
+    /**
+     * Set to true by snapshot event types, where only the newest undelivered event
+     * matters. A newer event with the same coalesceKey() then replaces the queued one.
+     */
+    constexpr static bool coalesce = false;
+
+    /// Distinguishes snapshots of the same type that should not replace each other (team/unit, say)
+    uint32_t coalesceKey() const { return 0; }
+
     // These variables should be automatically set by the Event constructor.
     /// Stores instance-level event category
     uint32_t i_category;
     /// Stores instance-level event ID
     uint32_t i_id;
+
+    /// Set by the EventSystem when the event is queued, used to measure delivery latency
+    std::chrono::steady_clock::time_point queuedAt;
+
+    /// Set by EventPool on events it owns, so that EventDeleter can hand them back
+    void (*recycler)(Event* event);
+
+    /// Set by the EventSystem on queued events that may still be replaced by a newer snapshot
+    bool coalescing;
+
+    /// The coalesceKey() of a queued snapshot
+    uint32_t i_coalesceKey;
+
+    /**
+     * Used by the EventSystem while the event is being delivered: the number of
+     * receiver mailboxes still holding the event, plus one for the delivery thread.
+     */
+    std::atomic<uint32_t> references;
 };
 
 /*!
@@ -55,42 +118,140 @@ enum HandleResult
     Unhandled // The handler could not handle this event, propogation should continue
 };
 
+/// Forward declaration of EventReceiver
+class EventReceiver;
+
+/*!
+ * Describes a single event handler on a receiver: the category/id of the event
+ * it accepts, plus a thunk that casts the receiver/event and calls the handler.
+ * The EventSystem uses the category/id to index handlers, so that events are only
+ * ever offered to the handlers that asked for them.
+ *
+ * Exactly one of handler/batchHandler is set.
+ */
+struct EventDispatcher
+{
+    uint32_t category;
+    uint32_t id;
+    HandleResult(*handler)(EventReceiver* receiver, Event* event);
+    HandleResult(*batchHandler)(EventReceiver* receiver, const std::vector<Event*>& events);
+};
+
+/*!
+ * Read-only view of the events of a single type handed to a batch handler, in queue order.
+ * The events are only valid for the duration of the handler call.
+ */
+template <typename T>
+class EventBatch
+{
+public:
+    class iterator
+    {
+    public:
+        explicit iterator(std::vector<Event*>::const_iterator it_) : it(it_) {}
+        T* operator*() const { return static_cast<T*>(*it); }
+        iterator& operator++() { ++it; return *this; }
+        bool operator!=(const iterator& other) const { return it != other.it; }
+    private:
+        std::vector<Event*>::const_iterator it;
+    };
+
+    explicit EventBatch(const std::vector<Event*>& events_) : events(events_) {}
+
+    size_t size() const { return events.size(); }
+    T* operator[](size_t i) const { return static_cast<T*>(events[i]); }
+    iterator begin() const { return iterator(events.begin()); }
+    iterator end() const { return iterator(events.end()); }
+
+private:
+    const std::vector<Event*>& events;
+};
+
+/*!
+ * Describes which thread a receiver's handlers are called on
+ */
+enum class DeliveryMode
+{
+    Inline,  // Handlers run on the EventSystem delivery thread, in between every other Inline receiver
+    Mailbox  // Events are posted to the receiver's own mailbox, which is drained by the worker pool
+};
+
 /*!
  * Interface for receiving events. Inherit from this
  * if you want to receive events.
+ *
+ * Receivers whose handlers may block (on a UI or simulation lock, for example) should
+ * use DeliveryMode::Mailbox, so that they do not hold up delivery to everyone else.
+ * Mailbox receivers still see their own events in queue order, one at a time, but
+ * in parallel with other receivers.
  */
 class EventReceiver
 {
 public:
-    /// Hooks this class into the event system
-    EventReceiver(std::vector<HandleResult(*)(EventReceiver*,Event*)> dispatchers_);
+    /// Hooks this class into the global event system
+    EventReceiver(std::vector<EventDispatcher> dispatchers_, DeliveryMode deliveryMode_ = DeliveryMode::Inline);
+
+    /// Hooks this class into the given event system, or the global one if it is nullptr
+    EventReceiver(EventSystem* eventSystem_, std::vector<EventDispatcher> dispatchers_,
+        DeliveryMode deliveryMode_ = DeliveryMode::Inline);
 
     /// Removes this class from the event system
     virtual ~EventReceiver();
 
     /// Handles a given event. You can use the dispatchEvent template to implement this for your class.
-    std::vector<HandleResult(*)(EventReceiver*,Event*)> dispatchers;
-    HandleResult(*dispatcher)(EventReceiver* handler, Event* event);
+    std::vector<EventDispatcher> dispatchers;
+
+    /// Which thread this receiver's handlers run on
+    DeliveryMode deliveryMode;
+
+    /// The event system this receiver is registered with. Receivers should queue their own events here.
+    EventSystem* eventSystem;
 };
 
+/*!
+ * Casts the receiver/event to their real types and calls the member function handler.
+ * The EventSystem only calls this with events matching T's category/id.
+ */
+template <typename Handler, typename T, HandleResult(Handler::*hfunc)(T*)>
+HandleResult dispatchThunk(EventReceiver* handler, Event* event)
+{
+    return (static_cast<Handler*>(handler)->*hfunc)(static_cast<T*>(event));
+}
+
 /*!
  * This is a helper template that handles dispatch/casting into member types.
- * Once you define an EventReciever, initalize it with a function pointer to
- * this type, once you include the various destination functions as template parameters
+ * Once you define an EventReciever, initalize it with the result of this
+ * function, once you include the various destination functions as template parameters
  *
  * The expected type handler functions are member functions that take a pointer
  * to the event type, and return a HandleResult.
  */
- template <typename Handler, typename T, HandleResult(Handler::*hfunc)(T*)>
- HandleResult dispatchEvent(EventReceiver* handler, Event* event)
- {
-    if (event->i_category == T::category && event->i_id == T::id)
-    {
-        return (static_cast<Handler*>(handler)->*hfunc)((T*)event);
-    }
-    return HandleResult::Unhandled;
- }
- 
+template <typename Handler, typename T, HandleResult(Handler::*hfunc)(T*)>
+EventDispatcher dispatchEvent()
+{
+    return EventDispatcher{T::category, T::id, &dispatchThunk<Handler, T, hfunc>, nullptr};
+}
+
+/// Wraps the events in an EventBatch and calls the member function batch handler
+template <typename Handler, typename T, HandleResult(Handler::*hfunc)(const EventBatch<T>&)>
+HandleResult batchThunk(EventReceiver* handler, const std::vector<Event*>& events)
+{
+    return (static_cast<Handler*>(handler)->*hfunc)(EventBatch<T>(events));
+}
+
+/*!
+ * Like dispatchEvent, but for a handler that takes every event of type T from one
+ * delivery pass in a single call. Useful when each event needs the same lock.
+ *
+ * Batch handlers are called after the receiver's per-event handlers have seen the
+ * whole pass, so they should not depend on ordering against other event types.
+ */
+template <typename Handler, typename T, HandleResult(Handler::*hfunc)(const EventBatch<T>&)>
+EventDispatcher dispatchBatch()
+{
+    return EventDispatcher{T::category, T::id, nullptr, &batchThunk<Handler, T, hfunc>};
+}
+
 /*!
  * This class handles all of the "plumbing" between various modules.
  *
@@ -98,8 +259,18 @@ public:
  * and gives a simple interface for delivering messages to others.
  *
  * Other classes can register to recieve certain "categories" of events.
- * Classes also register with a priority, wither higher priority
- * classes recieving events first.
+ * Events are delivered in priority order: each event type picks a lane
+ * with its static priority member, and higher priority lanes are drained
+ * first (see DrainPolicy).
+ *
+ * Receivers may register and deregister at any time, including from inside
+ * their own handlers: delivery works from an immutable snapshot of the routes,
+ * which registration replaces instead of locking.
+ *
+ * Normally there is one global EventSystem, which receivers register with by
+ * default. Additional, non-global EventSystems can be created and handed to
+ * receivers (and their Network), so several independent simulations can run
+ * side by side in one process.
  */
 class EventSystem
 {
@@ -107,8 +278,14 @@ public:
     /// Returns the global event handler pointer, useful for delivering events
     static EventSystem* getGlobalInstance();
 
-    /// Sets up internal EventSystem state, making it ready to deliver events
-    EventSystem(Network* network_);
+    /**
+     * Sets up internal EventSystem state, making it ready to deliver events.
+     * The mailbox worker pool is only started once a Mailbox receiver registers.
+     *
+     * A global EventSystem becomes the one returned by getGlobalInstance(); only one
+     * may exist at a time. Envelopes received by the network are queued here.
+     */
+    EventSystem(Network* network_, bool global_ = true, size_t mailboxWorkers_ = 2);
 
     /// Deregisters on deconstruction
     ~EventSystem();
@@ -119,10 +296,15 @@ public:
     /// Delete copy assignment
     EventSystem& operator=(const EventSystem& other) = delete;
 
-    /// Adds a given event receiver callback class to the delivery queue
+    /// Adds a given event receiver callback class to the delivery queue. Takes effect from the next delivery pass.
     void registerCallback(EventReceiver* receiver);
 
-    /// Removes a given event receiver callback calss from the delivery queue
+    /**
+     * Removes a given event receiver callback calss from the delivery queue.
+     * Once this returns, none of the receiver's handlers are running or will be called again,
+     * so it is safe to destroy it. Called from one of the receiver's own handlers, it only
+     * waits for handlers on other threads.
+     */
     void deregisterCallback(EventReceiver* receiver);
 
     /**
@@ -131,18 +313,112 @@ public:
      * pointers are thrown around. Using this templated delivery class ensures
      * that this is done safely (because delivery may happen afte the original event
      * has been deconstructed)
+     *
+     * The copy comes from a per-type EventPool and is recycled once delivered.
+     * It is queued in the lane given by T::priority.
+     *
+     * If T::coalesce is set and an older snapshot with the same key has not been
+     * delivered yet, that snapshot is overwritten instead of queueing a new one.
      */
     template<typename T>
-    void queueEvent(T event)
+    void queueEvent(const T& event)
     {
-        // Make a copy on the heap so we can manage it
-        T* copy = new T(event);
+        if (T::coalesce)
+        {
+            queueSnapshot<T>(event);
+            return;
+        }
 
-        std::unique_ptr<Event> copy_ptr(copy);
+        internalQueueEvent(EventPool<T>::acquire(event), T::priority);
+    }
+
+    /// Like queueEvent(const T&), but moves the event into the queue instead of copying it
+    template<typename T, typename = typename std::enable_if<
+        !std::is_lvalue_reference<T>::value && !std::is_const<T>::value
+        && !std::is_same<T, EnvelopeMessage>::value>::type>
+    void queueEvent(T&& event)
+    {
+        if (T::coalesce)
+        {
+            queueSnapshot<T>(std::move(event));
+            return;
+        }
+
+        internalQueueEvent(EventPool<T>::acquire(std::move(event)), T::priority);
+    }
+
+    /// Queues an event of type T constructed in place from the given arguments
+    template<typename T, typename... Args>
+    void emplaceEvent(Args&&... args)
+    {
+        if (T::coalesce)
+        {
+            queueSnapshot<T>(T(std::forward<Args>(args)...));
+            return;
+        }
+
+        internalQueueEvent(EventPool<T>::emplace(std::forward<Args>(args)...), T::priority);
+    }
+
+    /**
+     * Queues an event that already lives in EventPool<T> storage (from EventPool<T>::acquire()),
+     * taking it over instead of copying it. Used by the envelope decoder.
+     */
+    template<typename T>
+    void queuePooledEvent(EventPtr&& event)
+    {
+        if (T::coalesce)
+        {
+            queuePooledSnapshot<T>(std::move(event));
+            return;
+        }
 
-        internalQueueEvent(std::move(copy_ptr));
+        internalQueueEvent(std::move(event), T::priority);
     }
 
+    /**
+     * Sends an envelope straight through the network. Envelopes are never delivered
+     * locally, so no copy is made.
+     */
+    void queueEvent(const EnvelopeMessage& envelope);
+
+    /**
+     * Sends an envelope to every given node. The envelope is serialized once and the same
+     * bytes are sent to each, so per-tick broadcasts do not re-encode their event per client.
+     * The envelope's own address is ignored.
+     */
+    void queueBroadcast(const EnvelopeMessage& envelope, const std::set<RakNet::RakNetGUID>& destinations);
+
+    /// Sends a bundle of events (see TickBundler) to the given node as a single packet
+    void queueBundle(const EnvelopeBundle& bundle, RakNet::RakNetGUID destination);
+
+    /// Returns the event pool allocation counters, summed over all event types
+    static EventAllocationStats getAllocationStats();
+
+    /// Changes how the delivery thread picks between priority lanes (DrainPolicy::Weighted by default)
+    void setDrainPolicy(DrainPolicy policy);
+
+    /// Returns how many snapshots were overwritten by a newer one before being delivered
+    uint64_t getCoalescedDrops() const;
+
+    /**
+     * Returns the enqueue-to-dispatch latency distribution (in microseconds)
+     * of every event delivered so far with the given category.
+     */
+    LatencySummary getLatencySummary(uint32_t category);
+
+    /// Clears all recorded latency statistics
+    void resetLatencyStats();
+
+    /**
+     * Hands every delivered event to the given journal (see EventJournal), or stops doing so
+     * if nullptr. Once this returns, the previous journal is no longer called.
+     */
+    void setJournal(EventJournal* journal_);
+
+    /// Drops one reference to a delivered event, recycling it once nobody holds it. For taps that keep events past their pass.
+    static void releaseEvent(Event* event);
+
 private:
     /// Sets the global event handler pointer
     static void setGlobalInstance(EventSystem* system);
@@ -150,29 +426,253 @@ private:
     static EventSystem* singleton;
 
     /// Takes a given unique pointer (a moveable value) and stores it into the queue
-    void internalQueueEvent(std::unique_ptr<Event>&& event);
+    void internalQueueEvent(EventPtr&& event, EventPriority priority);
 
-    /// Loops until shutdwonFlag is true, delivering events on its own thread
+    /// Queues a T::coalesce event, or overwrites the queued snapshot with the same key
+    template<typename T, typename U>
+    void queueSnapshot(U&& event)
+    {
+        uint32_t coalesceKey = event.coalesceKey();
+        uint64_t key = snapshotKey(T::category, T::id, coalesceKey);
+        EventPtr copy;
+        {
+            std::lock_guard<std::mutex> lock(snapshotMux);
+            Event* pending = findPendingSnapshot(key);
+            if (pending)
+            {
+                // Keep the original queue time, so latency still covers the whole wait
+                auto queuedAt = pending->queuedAt;
+                *static_cast<T*>(pending) = std::forward<U>(event);
+                pending->queuedAt = queuedAt;
+                ++coalescedDrops;
+                return;
+            }
+
+            copy = EventPool<T>::acquire(std::forward<U>(event));
+            copy->coalescing = true;
+            copy->i_coalesceKey = coalesceKey;
+            copy->queuedAt = std::chrono::steady_clock::now();
+            pendingSnapshots.emplace_back(key, copy.get());
+        }
+        // Other producers may already be writing into the copy, so it is pushed as-is
+        events.push(std::move(copy), T::priority);
+    }
+
+    /// Like queueSnapshot, for an event that is already pooled
+    template<typename T>
+    void queuePooledSnapshot(EventPtr&& event)
+    {
+        T& snapshot = *static_cast<T*>(event.get());
+        uint32_t coalesceKey = snapshot.coalesceKey();
+        uint64_t key = snapshotKey(T::category, T::id, coalesceKey);
+        {
+            std::lock_guard<std::mutex> lock(snapshotMux);
+            Event* pending = findPendingSnapshot(key);
+            if (pending)
+            {
+                // Swapped rather than moved, so the stale contents go back to the pool with their capacity
+                auto queuedAt = pending->queuedAt;
+                std::swap(*static_cast<T*>(pending), snapshot);
+                pending->queuedAt = queuedAt;
+                ++coalescedDrops;
+                return;
+            }
+
+            event->coalescing = true;
+            event->i_coalesceKey = coalesceKey;
+            event->queuedAt = std::chrono::steady_clock::now();
+            pendingSnapshots.emplace_back(key, event.get());
+        }
+        events.push(std::move(event), T::priority);
+    }
+
+    /// Loops until the queue is closed, delivering events on its own thread
     void deliverEvents();
 
-    /// Set that stores all active callbacks
+    /// Returns the pendingSnapshots key of a snapshot. Category/id must fit in 16 bits.
+    static uint64_t snapshotKey(uint32_t category, uint32_t id, uint32_t coalesceKey);
+
+    /// Returns the queued snapshot with the given key, or nullptr. Requires snapshotMux.
+    Event* findPendingSnapshot(uint64_t key);
+
+    /// Stops the given snapshots from being replaced, as they are about to be delivered
+    void retireSnapshots(const std::vector<EventPtr>& delivering);
+
+    struct RouteTable;
+
+    /// Offers one event to its routes, calling inline handlers and collecting batch/mailbox deliveries
+    void routeEvent(const RouteTable& table, Event* event);
+
+    /// Returns true if the given receiver was deregistered by a handler earlier in this pass
+    bool removedDuringPass(EventReceiver* receiver) const;
+
+    /// Blocks until the delivery thread is not in a pass that uses a table older than the given generation
+    void waitForPass(uint64_t generation);
+
+    /// Pending events for a single DeliveryMode::Mailbox receiver
+    struct Mailbox
+    {
+        EventReceiver* receiver;
+
+        /// Events waiting to be handled, in queue order
+        std::deque<Event*> pending;
+
+        /// Events taken by the worker currently draining the mailbox
+        std::vector<Event*> draining;
+
+        /// Events collected for each of the receiver's batch handlers, indexed like its dispatchers
+        std::vector<std::vector<Event*>> batches;
+
+        /// Set while the mailbox is in the run queue or being drained, so only one worker drains it
+        bool scheduled;
+
+        /// Set once the receiver has deregistered. Written under mux, but checked by the draining worker without it.
+        std::atomic<bool> closed;
+
+        /// Worker currently draining the mailbox, so a handler deregistering its own receiver does not wait on itself
+        std::thread::id drainer;
+
+        /// Protects the mailbox
+        std::mutex mux;
+
+        /// Signalled when a worker stops draining the mailbox
+        std::condition_variable idle;
+    };
+
+    /// Most events a worker takes from one mailbox at once, before giving other mailboxes a turn
+    constexpr static size_t MailboxBatch = 64;
+
+    /// Most events the delivery thread takes off the queue per pass
+    constexpr static size_t DrainBatch = 256;
+
+    /// Adds an event to a mailbox, scheduling the mailbox if it was idle
+    void postToMailbox(const std::shared_ptr<Mailbox>& mailbox, Event* event);
+
+    /// Worker pool thread: drains scheduled mailboxes until shutdown
+    void runMailboxes();
+
+    /// Handles a batch of events from the given mailbox, rescheduling it if it still has work
+    void drainMailbox(const std::shared_ptr<Mailbox>& mailbox);
+
+    /// Returns the dispatch table key for a category/id pair
+    static uint64_t dispatchKey(uint32_t category, uint32_t id);
+
+    /// Set that stores all active callbacks. Protected by callbackMux.
     std::set<EventReceiver*> callbacks;
 
-    /// Deque that stores all events to be delivered
-    std::deque<std::unique_ptr<Event>> events;
+    /// A single receiver handler that an event should be offered to
+    struct DispatchRoute
+    {
+        EventReceiver* receiver;
+        HandleResult(*handler)(EventReceiver* receiver, Event* event);
+        HandleResult(*batchHandler)(EventReceiver* receiver, const std::vector<Event*>& events);
+        /// Set if the receiver uses DeliveryMode::Mailbox
+        std::shared_ptr<Mailbox> mailbox;
+    };
+
+    /**
+     * Index from (category, id) to the handlers interested in it. Routes are kept
+     * ordered by receiver, in the same order that callbacks are iterated in.
+     *
+     * A published table is never modified; registration publishes a changed copy.
+     */
+    struct RouteTable
+    {
+        /// Incremented with every published table, starting from 1
+        uint64_t generation;
+
+        std::unordered_map<uint64_t, std::vector<DispatchRoute>> routes;
+    };
+
+    /// Replaces the current route table. Requires callbackMux.
+    void publishRoutes(const std::shared_ptr<RouteTable>& table);
+
+    /// Events collected for one inline batch handler during a delivery pass
+    struct PendingBatch
+    {
+        EventReceiver* receiver;
+        HandleResult(*batchHandler)(EventReceiver* receiver, const std::vector<Event*>& events);
+        std::vector<Event*> events;
+    };
+
+    /// Batches of inline receivers, kept while the routes do not change to reuse their storage. Delivery thread only.
+    std::vector<PendingBatch> pendingBatches;
 
-    /// Mutex that protects the queue
-    std::mutex queueMux;
+    /// Route table generation that pendingBatches was built for. Delivery thread only.
+    uint64_t batchGeneration;
 
-    /// Mutex that protects the callback class
+    /// Receivers deregistered by a handler during the current pass, and possibly destroyed. Delivery thread only.
+    std::vector<EventReceiver*> removedThisPass;
+
+    /// Events taken off the queue in the current pass. Delivery thread only.
+    std::vector<EventPtr> drained;
+
+    /// The current route table. Read and replaced with std::atomic_load/atomic_store.
+    std::shared_ptr<const RouteTable> routeTable;
+
+    /// Generation of the table used by the delivery pass in progress, or 0 between passes. Protected by passMux.
+    uint64_t passGeneration;
+
+    /// Protects passGeneration
+    std::mutex passMux;
+
+    /// Signalled at the end of every delivery pass
+    std::condition_variable passDone;
+
+    /// Lock-free queue that stores all events to be delivered
+    EventQueue events;
+
+    /// Snapshots still in the queue, by snapshotKey. Kept small, so a vector beats a map.
+    std::vector<std::pair<uint64_t, Event*>> pendingSnapshots;
+
+    /// Protects pendingSnapshots, and the contents of the snapshots in it
+    std::mutex snapshotMux;
+
+    /// Number of snapshots replaced before delivery, in the queue or in a mailbox
+    std::atomic<uint64_t> coalescedDrops;
+
+    /// Serializes changes to callbacks, mailboxes and the route table. Never held while handlers run.
     std::mutex callbackMux;
 
-    /// Atomic that indicates when shutdown should occur
-    std::atomic<bool> shutdownFlag;
+    /// Journal that delivered events are handed to, if any. Protected by journalMux.
+    EventJournal* journal;
+
+    /// Protects journal; taken once per delivery pass
+    std::mutex journalMux;
+
+    /// Mailboxes of registered DeliveryMode::Mailbox receivers
+    std::map<EventReceiver*, std::shared_ptr<Mailbox>> mailboxes;
+
+    /// Mailboxes with events waiting for a worker
+    std::deque<std::shared_ptr<Mailbox>> runQueue;
+
+    /// Protects the run queue and workersStopping
+    std::mutex runMux;
+
+    /// Signalled when a mailbox is scheduled, or on shutdown
+    std::condition_variable runSignal;
+
+    /// Set when the worker pool should exit
+    bool workersStopping;
+
+    /// Number of worker threads to start
+    size_t mailboxWorkers;
+
+    /// Worker pool threads, started by the first Mailbox receiver
+    std::vector<std::thread> workers;
 
     /// Thread that delivers events to event receivers
     std::thread deliveryThread;
 
     /// Stores the network pointer, while open
     Network* network;
+
+    /// True if this is the global instance
+    bool global;
+
+    /// Per-category histograms of enqueue-to-dispatch latency
+    std::map<uint32_t, LatencyHistogram> latency;
+
+    /// Mutex that protects the latency histograms
+    std::mutex statsMux;
 };
@@ -56,6 +56,15 @@ public:
     EnvelopeError(const std::string& err) : std::runtime_error(err) {}
 };
 
+/**
+ * Exception representing an event journal that could not be written or read
+ */
+class JournalError : public std::runtime_error
+{
+public:
+    JournalError(const std::string& err) : std::runtime_error(err) {}
+};
+
 /**
  * Exception representing an SDL error
  */
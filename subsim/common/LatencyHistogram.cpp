@@ -0,0 +1,83 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+uint32_t LatencyHistogram::bucketFor(uint64_t micros)
+{
+    if (micros < SubBuckets)
+    {
+        return micros;
+    }
+
+    // Find the most significant bit, then use the next SubBucketBits bits as the linear sub-bucket
+    uint32_t msb = 63;
+    while ((micros & (1ull << msb)) == 0)
+    {
+        --msb;
+    }
+    uint32_t shift = msb - SubBucketBits;
+    return (shift + 1) * SubBuckets + ((micros >> shift) - SubBuckets);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t bucket)
+{
+    if (bucket < SubBuckets)
+    {
+        return bucket;
+    }
+
+    uint32_t shift = bucket / SubBuckets - 1;
+    uint64_t lower = (uint64_t)(SubBuckets + bucket % SubBuckets) << shift;
+    return lower + ((1ull << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t micros)
+{
+    ++buckets[bucketFor(micros)];
+    ++count;
+    maxSeen = std::max(maxSeen, micros);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(fraction * count));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NumBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            // Never report more than what we actually saw
+            return std::min(bucketUpperBound(i), maxSeen);
+        }
+    }
+    return maxSeen;
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary result;
+    result.count = count;
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.max = maxSeen;
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    buckets.fill(0);
+    count = 0;
+    maxSeen = 0;
+}
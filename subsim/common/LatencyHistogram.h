@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*!
+ * Summary of a latency distribution, in microseconds.
+ */
+struct LatencySummary
+{
+    /// Number of samples recorded
+    uint64_t count;
+    /// Median latency
+    uint64_t p50;
+    /// 99th percentile latency
+    uint64_t p99;
+    /// Largest latency seen
+    uint64_t max;
+};
+
+/*!
+ * Fixed-size log-linear histogram of latencies measured in microseconds.
+ *
+ * Samples are bucketed by their power of two, with each power of two split into
+ * a fixed number of linear sub-buckets, so reported percentiles are accurate to
+ * within 1/SubBuckets of the true value. Recording is O(1) and never allocates.
+ *
+ * The histogram is not thread safe; callers are expected to provide their own locking.
+ */
+class LatencyHistogram
+{
+public:
+    /// Creates an empty histogram
+    LatencyHistogram();
+
+    /// Adds a single latency sample, in microseconds
+    void record(uint64_t micros);
+
+    /// Returns the (upper bound of the) latency below which the given fraction of samples fall
+    uint64_t percentile(double fraction) const;
+
+    /// Returns count/p50/p99/max in one go
+    LatencySummary summary() const;
+
+    /// Drops all recorded samples
+    void reset();
+
+private:
+    /// Number of linear sub-buckets in each power of two
+    constexpr static uint32_t SubBucketBits = 3;
+    constexpr static uint32_t SubBuckets = 1 << SubBucketBits;
+    /// Enough powers of two to cover a full uint64_t
+    constexpr static uint32_t NumBuckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+    /// Maps a sample onto its bucket index
+    static uint32_t bucketFor(uint64_t micros);
+
+    /// Returns the largest value that maps onto the given bucket
+    static uint64_t bucketUpperBound(uint32_t bucket);
+
+    std::array<uint64_t, NumBuckets> buckets;
+    uint64_t count;
+    uint64_t maxSeen;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MessageIdentifiers.h"
+#include "PacketPriority.h"
 #include "RakNetTypes.h"
 
 #include "EventSystem.h"
@@ -8,6 +9,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace RakNet
 {
@@ -22,6 +25,48 @@ enum MessageType
     ID_LOBBY_STATUS_REQUEST,
     ID_LOBBY_STATUS,
     ID_ENVELOPE,
+    ID_ENVELOPE_BUNDLE,
+};
+
+namespace Channels
+{
+
+/// RakNet ordering channels. Ordered and sequenced messages are only ordered against others on the same channel
+enum OrderingChannel : char
+{
+    /// Connection setup, such as version messages
+    Control = 0,
+    /// Per-tick state, where only the newest matters
+    Snapshots,
+    /// Player inputs and game status updates
+    Inputs,
+    /// Simulation start, config and terrain
+    Setup,
+    /// Any other event
+    Events,
+};
+
+}
+
+/*!
+ * How RakNet delivers a message: its reliability, priority and ordering channel.
+ * Envelopes pick theirs by event type; see EnvelopeMessage::deliveryPolicy.
+ */
+struct DeliveryPolicy
+{
+    PacketReliability reliability;
+    PacketPriority priority;
+    char channel;
+
+    bool operator==(const DeliveryPolicy& other) const
+    {
+        return reliability == other.reliability && priority == other.priority && channel == other.channel;
+    }
+
+    bool operator!=(const DeliveryPolicy& other) const
+    {
+        return !(*this == other);
+    }
 };
 
 /*!
@@ -59,32 +104,144 @@ struct VersionMessage
 };
 
 /*!
- * Class that supports serializing/deserializing an Event, by enclosing it in an envelope
+ * Class that supports serializing/deserializing an Event, by enclosing it in an envelope.
+ *
+ * The enclosed event is a pooled copy, so envelopes can be moved but not copied.
  */
 struct EnvelopeMessage : public MessageInterface, public Event
 {
     RakNet::RakNetGUID address;
 
-    std::shared_ptr<Event> event;
+    EventPtr event;
+
+    /// EventSystem that a deserialized event is queued in; the global one if nullptr
+    EventSystem* destination;
 
-    EnvelopeMessage(RakNet::BitStream& source, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID);
+    /// Deserializes an envelope, queueing the enclosed event in the given (or global) EventSystem
+    EnvelopeMessage(RakNet::BitStream& source, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID,
+        EventSystem* destination_ = nullptr);
 
     EnvelopeMessage()
         : Event(category, type)
+        , destination(nullptr)
     {}
 
     template <typename T>
     EnvelopeMessage(const T& event_, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID)
-        : address(address_)
-        , event(new T(event_))
-        , Event(category, type)
+        : Event(category, type)
+        , address(address_)
+        , event(EventPool<T>::acquire(event_))
+        , destination(nullptr)
+    {}
+
+    /**
+     * Moves the given event into the envelope instead of copying it. To send one event
+     * to several nodes, build the envelope once and pass it to EventSystem::queueBroadcast.
+     */
+    template <typename T, typename = typename std::enable_if<std::is_base_of<Event, T>::value
+        && !std::is_lvalue_reference<T>::value && !std::is_const<T>::value
+        && !std::is_same<T, EnvelopeMessage>::value>::type>
+    EnvelopeMessage(T&& event_, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID)
+        : Event(category, type)
+        , address(address_)
+        , event(EventPool<T>::acquire(std::move(event_)))
+        , destination(nullptr)
     {}
 
+    /// Takes ownership of a pooled event, such as one from EventPool<T>::emplace
+    EnvelopeMessage(EventPtr&& event_, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID)
+        : Event(category, type)
+        , address(address_)
+        , event(std::move(event_))
+        , destination(nullptr)
+    {}
+
+    EnvelopeMessage(EnvelopeMessage&& other) = default;
+    EnvelopeMessage& operator=(EnvelopeMessage&& other) = default;
+
     RakNet::MessageID getType() const override;
     void deserialize(RakNet::BitStream& source) override;
     void serialize(RakNet::BitStream& source) const override;
 
+    /**
+     * Writes the fields of an event, without its category/id, to the given bitstream.
+     * Returns false if the event type has no serialization code.
+     */
+    static bool serializeEvent(const Event& event, RakNet::BitStream& source);
+
+    /**
+     * Reads the fields of an event with the given category/id from the bitstream, and queues it
+     * in the given EventSystem. Returns false if the event type has no deserialization code.
+     */
+    static bool deserializeEvent(uint32_t category, uint32_t id, RakNet::BitStream& source, EventSystem* events,
+        RakNet::RakNetGUID address = RakNet::UNASSIGNED_RAKNET_GUID);
+
+    /**
+     * Returns how many bits serializeEvent will write for the given event,
+     * or zero if the event type has no serialization code.
+     */
+    static size_t estimateEventBits(const Event& event);
+
+    /**
+     * Returns how envelopes holding events of the given type are sent:
+     * - snapshots (sonar, unit state and score updates, and their acks) unreliable and
+     *   sequenced on their own channel, so a lost one is replaced by the next, not resent
+     * - inputs and status updates reliable and ordered, at high priority, on their own channel
+     * - simulation start, then config and terrain (at low priority), reliable and ordered on their own channel
+     * - anything else reliable and ordered on a shared channel
+     */
+    static DeliveryPolicy deliveryPolicy(uint32_t category, uint32_t id);
+
+    /// Returns how this envelope is sent, given the event it holds
+    DeliveryPolicy deliveryPolicy() const;
+
     constexpr static uint32_t category = Events::Category::Network;
     constexpr static uint32_t type = Events::Net::Envelope;
 };
+
+/*!
+ * Several events for one node, sent as a single packet. Built by a TickBundler, which
+ * only bundles events with the same delivery policy together.
+ *
+ * Each entry holds the event's category/id (16 bits each, as for snapshot keys), its size in
+ * bits, and the event as serializeEvent writes it. Entries of unknown types are skipped.
+ */
+struct EnvelopeBundle : public MessageInterface
+{
+    EnvelopeBundle();
+
+    /// Deserializes a bundle, queueing every enclosed event in the given (or global) EventSystem
+    EnvelopeBundle(RakNet::BitStream& source, RakNet::RakNetGUID address_ = RakNet::UNASSIGNED_RAKNET_GUID,
+        EventSystem* destination_ = nullptr);
+
+    ~EnvelopeBundle();
+
+    EnvelopeBundle(EnvelopeBundle&& other);
+    EnvelopeBundle& operator=(EnvelopeBundle&& other);
+
+    /// Appends an event of the given type, already written by EnvelopeMessage::serializeEvent
+    void append(uint32_t category, uint32_t id, RakNet::BitStream& payload);
+
+    /// Bytes this bundle takes in a packet, after appending an event of the given size
+    static size_t bytesWith(size_t bundleBits, size_t payloadBits);
+
+    RakNet::MessageID getType() const override;
+    void deserialize(RakNet::BitStream& source) override;
+    void serialize(RakNet::BitStream& source) const override;
+
+    /// Number of events in the bundle
+    uint16_t count;
+
+    /// How the bundle is sent, shared by every event in it
+    DeliveryPolicy policy;
+
+    /// The entries, back to back
+    std::unique_ptr<RakNet::BitStream> entries;
+
+    /// Node the bundle came from
+    RakNet::RakNetGUID address;
+
+    /// EventSystem that deserialized events are queued in; the global one if nullptr
+    EventSystem* destination;
+};
     
@@ -5,6 +5,9 @@
 
 #include "RakNetTypes.h" // For SocketDescriptor
 #include "RakPeerInterface.h" // For RakPeer
+#include "RakNetSocket2.h" // For RNS2RecvStruct
+#include "DS_List.h" // For DataStructures::List
+#include "RakNetStatistics.h" // For RakNetStatistics
 #include "BitStream.h"
 
 #include "Log.h"
@@ -15,16 +18,91 @@
 #include <iostream>
 #include <thread> // For std::this_thread
 #include <chrono> // For std::chrono::milliseconds
+#include <algorithm>
+#include <condition_variable>
+#include <iterator>
+#include <map>
+#include <vector>
 
+/*!
+ * Longest the receive thread waits for a datagram. RakNet also queues a few packets of its own
+ * without one arriving, such as lost connections and failed connection attempts, but those
+ * follow timeouts of seconds, so noticing them up to this late does not matter.
+ */
+static const std::chrono::milliseconds MaxPacketWait(100);
+
+/// How long after a datagram the receive thread looks for its packet, while RakNet's update thread processes it
+static const std::chrono::microseconds DatagramPollWindow(1000);
+
+/// Longest sleep between those looks. They start with a yield and back off to this
+static const std::chrono::microseconds MaxDatagramPollInterval(256);
+
+/*!
+ * Longest the receive thread waits while a datagram's packet is still missing after that window,
+ * such as when RakNet's update thread was not scheduled in time. Datagrams that only carry acks
+ * or pings never become packets, so this stops MaxPacketWait after the datagram.
+ */
+static const std::chrono::milliseconds MaxMissingPacketWait(10);
+
+/// Networks by the RakNet sockets they own, so a datagram only wakes the Network it arrived at
+static std::mutex networksMutex;
+static std::map<RakNet::RakNetSocket2*, Network*> networksBySocket;
+
+bool Network::onIncomingDatagram(RakNet::RNS2RecvStruct* datagram)
+{
+    {
+        std::lock_guard<std::mutex> lock(networksMutex);
+        auto it = networksBySocket.find(datagram->socket);
+        if (it != networksBySocket.end())
+        {
+            it->second->signalPackets();
+        }
+    }
+    // Let RakNet process the datagram as usual
+    return true;
+}
+
+void Network::signalPackets()
+{
+    {
+        std::lock_guard<std::mutex> lock(packetSignalMutex);
+        ++packetSignalCount;
+    }
+    packetSignal.notify_all();
+}
+
+uint64_t Network::currentPacketSignal()
+{
+    std::lock_guard<std::mutex> lock(packetSignalMutex);
+    return packetSignalCount;
+}
+
+bool Network::waitForPacketSignal(uint64_t seen, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(packetSignalMutex);
+    return packetSignal.wait_for(lock, timeout, [this, seen] { return packetSignalCount != seen; });
+}
+
+
+constexpr size_t Network::MaxQueuedBytes;
+constexpr size_t Network::MaxBufferedBytes;
 
-Network::Network(bool is_server)
-    : shouldShutdown(false)
+Network::Network(bool is_server, unsigned short port)
+    : eventSystem(nullptr)
+    , callbacks(std::make_shared<const std::set<ReceiveInterface*>>())
+    , callbackGeneration(1)
+    , dispatchGeneration(0)
+    , shouldShutdown(false)
+    , outboundPending(false)
+    , stopSending(false)
+    , droppedSnapshots(0)
+    , packetSignalCount(0)
 {
     node = RakNet::RakPeerInterface::GetInstance();
 
     // Use an empty socket descriptor if we're a client
     RakNet::SocketDescriptor sd = is_server ? 
-        RakNet::SocketDescriptor(NETWORK_SERVER_PORT, 0) : RakNet::SocketDescriptor();
+        RakNet::SocketDescriptor(port, 0) : RakNet::SocketDescriptor();
     unsigned short num_clients = is_server ? NETWORK_MAX_CLIENTS : 1;
 
     Log::writeToLog(Log::L_DEBUG, "Starting networking with ", num_clients, " possible active connections");
@@ -33,7 +111,7 @@ Network::Network(bool is_server)
     {
         if (is_server)
         {
-            Log::writeToLog(Log::FATAL, "Couldn't start networking as the server! Tried to bind to port ", NETWORK_SERVER_PORT);
+            Log::writeToLog(Log::FATAL, "Couldn't start networking as the server! Tried to bind to port ", port);
         } else {
             Log::writeToLog(Log::FATAL, "Couldn't start networking as a client!");
         }
@@ -47,20 +125,50 @@ Network::Network(bool is_server)
         node->SetMaximumIncomingConnections(NETWORK_MAX_CLIENTS);
     }
 
-    Log::writeToLog(Log::L_DEBUG, "Starting networking thread");
+    /* Wake the networking thread as soon as anything arrives at one of our sockets */
+    {
+        DataStructures::List<RakNet::RakNetSocket2*> sockets;
+        node->GetSockets(sockets);
+        std::lock_guard<std::mutex> lock(networksMutex);
+        for (unsigned int i = 0; i < sockets.Size(); ++i)
+        {
+            networksBySocket[sockets[i]] = this;
+        }
+    }
+    node->SetIncomingDatagramEventHandler(&Network::onIncomingDatagram);
+
+    Log::writeToLog(Log::L_DEBUG, "Starting networking threads");
     recieveThread = std::thread(&Network::handlePackets, this);
+    sendThread = std::thread(&Network::sendPackets, this);
 }
 
 Network::~Network()
 {
     Log::writeToLog(Log::INFO, "Shutting down networking");
+    {
+        std::lock_guard<std::mutex> lock(networksMutex);
+        for (auto it = networksBySocket.begin(); it != networksBySocket.end();)
+        {
+            it = it->second == this ? networksBySocket.erase(it) : std::next(it);
+        }
+    }
+
+    Log::writeToLog(Log::L_DEBUG, "Signaling send thread to hand over what is queued and close...");
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        stopSending = true;
+    }
+    outboundReady.notify_all();
+    sendThread.join();
+
     Log::writeToLog(Log::L_DEBUG, "Signaling networking thread to close...");
     /* Shutdown inside a locked mutex. Lock guard for exception safety */
     {
         std::lock_guard<std::mutex> lock(shutdownMutex);
         shouldShutdown = true;
     }
-    // Wait for the networking thread to fully shutdown
+    // Wake the networking thread if it is waiting for packets, then wait for it to fully shutdown
+    signalPackets();
     recieveThread.join();
     Log::writeToLog(Log::L_DEBUG, "Networking thread closed! Waiting for connections to close.");
     node->Shutdown(500);
@@ -68,65 +176,273 @@ Network::~Network()
     Log::writeToLog(Log::INFO, "Networking fully shutdown.");
 }
 
-void Network::connect(const std::string& hostname)
+void Network::connect(const std::string& hostname, unsigned short port)
 {
-    Log::writeToLog(Log::L_DEBUG, "Attempting to connect to server:", hostname, " on port ", NETWORK_SERVER_PORT);
-    if (node->Connect(hostname.c_str(), NETWORK_SERVER_PORT, 0, 0) != RakNet::CONNECTION_ATTEMPT_STARTED)
+    Log::writeToLog(Log::L_DEBUG, "Attempting to connect to server:", hostname, " on port ", port);
+    if (node->Connect(hostname.c_str(), port, 0, 0) != RakNet::CONNECTION_ATTEMPT_STARTED)
     {
-        Log::writeToLog(Log::ERR, "Couldn't connect to server: ", hostname, " on port ", NETWORK_SERVER_PORT);
+        Log::writeToLog(Log::ERR, "Couldn't connect to server: ", hostname, " on port ", port);
         throw NetworkConnectionError("Couldn't initiate connection to remote host!");
     }
 }
 
+void Network::setEventSystem(EventSystem* eventSystem_)
+{
+    eventSystem = eventSystem_;
+}
+
 void Network::registerCallback(ReceiveInterface* callback)
 {
-    if (callbacks.insert(callback).second == false)
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    std::shared_ptr<std::set<ReceiveInterface*>> updated =
+        std::make_shared<std::set<ReceiveInterface*>>(*std::atomic_load(&callbacks));
+    if (updated->insert(callback).second == false)
     {
         Log::writeToLog(Log::WARN, "Callback class ", callback, "already registered! Ignoring.");
     } else {
         /* Set network pointer so the callback can call network functions */
         callback->network = this;
+        publishCallbacks(std::move(updated));
         Log::writeToLog(Log::L_DEBUG, "Registered callback class ", callback);
     }
 }
 
 void Network::deregisterCallback(ReceiveInterface* callback)
 {
-    auto it = callbacks.find(callback);
-
-    if (it == callbacks.end())
+    uint64_t generation;
     {
-        Log::writeToLog(Log::ERR, "Attempted to remove callback ", callback, " that was not registered!");
-        throw std::runtime_error("Removal of unregistered callback attempted!");
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        std::shared_ptr<std::set<ReceiveInterface*>> updated =
+            std::make_shared<std::set<ReceiveInterface*>>(*std::atomic_load(&callbacks));
+        auto it = updated->find(callback);
+
+        if (it == updated->end())
+        {
+            Log::writeToLog(Log::ERR, "Attempted to remove callback ", callback, " that was not registered!");
+            throw std::runtime_error("Removal of unregistered callback attempted!");
+        }
+
+        (*it)->network = nullptr;
+        updated->erase(it);
+        generation = publishCallbacks(std::move(updated));
     }
 
-    (*it)->network = nullptr;
-    callbacks.erase(it);
+    // A dispatch that started with the old set may still call the callback. If we are inside
+    // one, the rest of it skips the callback instead; otherwise wait for it to end.
+    if (std::this_thread::get_id() == recieveThread.get_id())
+    {
+        removedThisDispatch.insert(callback);
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(dispatchMutex);
+        dispatchDone.wait(lock, [this, generation]{ return dispatchGeneration == 0 || dispatchGeneration >= generation; });
+    }
 
     Log::writeToLog(Log::L_DEBUG, "Deregistered callback class ", callback);
 }
 
-void Network::sendMessage(RakNet::RakNetGUID destination, MessageInterface* message, PacketReliability reliability)
+uint64_t Network::publishCallbacks(std::shared_ptr<std::set<ReceiveInterface*>>&& updated)
+{
+    std::lock_guard<std::mutex> lock(dispatchMutex);
+    std::atomic_store(&callbacks, std::shared_ptr<const std::set<ReceiveInterface*>>(std::move(updated)));
+    return ++callbackGeneration;
+}
+
+void Network::sendMessage(RakNet::RakNetGUID destination, const MessageInterface* message, PacketReliability reliability)
+{
+    queueMessage({destination}, message, serializeMessage(message), reliability, MEDIUM_PRIORITY,
+        (char)message->getType());
+}
+
+void Network::sendMessage(RakNet::RakNetGUID destination, const MessageInterface* message, const DeliveryPolicy& policy)
+{
+    queueMessage({destination}, message, serializeMessage(message), policy.reliability, policy.priority, policy.channel);
+}
+
+void Network::broadcastMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+    PacketReliability reliability)
+{
+    queueMessage(destinations, message, serializeMessage(message), reliability, MEDIUM_PRIORITY,
+        (char)message->getType());
+}
+
+void Network::broadcastMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+    const DeliveryPolicy& policy)
+{
+    queueMessage(destinations, message, serializeMessage(message), policy.reliability, policy.priority, policy.channel);
+}
+
+std::shared_ptr<const RakNet::BitStream> Network::serializeMessage(const MessageInterface* message)
+{
+    std::shared_ptr<RakNet::BitStream> outStream = std::make_shared<RakNet::BitStream>();
+    outStream->Write((RakNet::MessageID)message->getType());
+    message->serialize(*outStream);
+    return outStream;
+}
+
+void Network::queueMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+    std::shared_ptr<const RakNet::BitStream> data, PacketReliability reliability, PacketPriority priority, char channel)
 {
-    // Check that this actually is a valid destination
-    if (confirmedConnections.count(destination) == 0)
     {
-        Log::writeToLog(Log::WARN, "Attempted to send a message of type:", message->getType(),
-            " to invalid destination GUID:", destination);
-        throw InvalidDestinationError("Attempted to send a message to invalid destination.");
+        std::lock_guard<std::mutex> lock(connectionMutex);
+
+        // Check that these actually are valid destinations, before queueing anything
+        for (const RakNet::RakNetGUID& destination : destinations)
+        {
+            if (confirmedConnections.count(destination) == 0)
+            {
+                Log::writeToLog(Log::WARN, "Attempted to send a message of type:", message->getType(),
+                    " to invalid destination GUID:", destination);
+                throw InvalidDestinationError("Attempted to send a message to invalid destination.");
+            }
+        }
+
+        for (const RakNet::RakNetGUID& destination : destinations)
+        {
+            OutboundQueue& queue = outbound[destination];
+            queue.packets.push_back(OutboundPacket{data, reliability, priority, channel});
+            queue.bytes += data->GetNumberOfBytesUsed();
+            if (queue.bytes > MaxQueuedBytes)
+            {
+                dropStaleSnapshots(queue);
+            }
+        }
+        outboundPending = true;
     }
+    outboundReady.notify_one();
+}
 
-    RakNet::BitStream outStream;
-    outStream.Write((RakNet::MessageID)message->getType());
-    message->serialize(outStream);
+void Network::dropStaleSnapshots(OutboundQueue& queue)
+{
+    // The newest message stays, so the node gets the latest snapshot once it catches up
+    auto it = queue.packets.begin();
+    while (queue.bytes > MaxQueuedBytes && it + 1 < queue.packets.end())
+    {
+        if (it->reliability == UNRELIABLE || it->reliability == UNRELIABLE_SEQUENCED)
+        {
+            queue.bytes -= it->data->GetNumberOfBytesUsed();
+            it = queue.packets.erase(it);
+            ++droppedSnapshots;
+        } else {
+            ++it;
+        }
+    }
+}
+
+double Network::bufferedBytes(RakNet::RakNetGUID destination)
+{
+    RakNet::RakNetStatistics statistics;
+    if (!node->GetStatistics(node->GetSystemAddressFromGuid(destination), &statistics))
+    {
+        return 0;
+    }
 
-    if (node->Send(&outStream, PacketPriority::MEDIUM_PRIORITY, reliability, message->getType(), destination, false) == 0)
+    double bytes = 0;
+    for (uint32_t i = 0; i < NUMBER_OF_PRIORITIES; ++i)
+    {
+        bytes += statistics.bytesInSendBuffer[i];
+    }
+    return bytes;
+}
+
+void Network::sendPackets()
+{
+    std::vector<RakNet::RakNetGUID> destinations;
+    std::vector<std::pair<RakNet::RakNetGUID, OutboundPacket>> batch;
+    std::unique_lock<std::mutex> lock(connectionMutex);
+    while (true)
     {
-        Log::writeToLog(Log::ERR, "Unable to send message with type:", message->getType(), " to system ", destination);
-        throw NetworkMessageError("Unable to send message to destination");
+        bool stopping = stopSending;
+        outboundPending = false;
+        destinations.clear();
+        for (auto& pair : outbound)
+        {
+            if (!pair.second.packets.empty())
+            {
+                destinations.push_back(pair.first);
+            }
+        }
+
+        // RakNet is only called with the lock released, so queueing never waits on it
+        lock.unlock();
+        std::vector<double> buffered(destinations.size(), 0);
+        if (!stopping)
+        {
+            for (size_t i = 0; i < destinations.size(); ++i)
+            {
+                buffered[i] = bufferedBytes(destinations[i]);
+            }
+        }
+        lock.lock();
+
+        // Take what RakNet has room for from each queue; everything when shutting down
+        bool backedUp = false;
+        for (size_t i = 0; i < destinations.size(); ++i)
+        {
+            auto queue = outbound.find(destinations[i]);
+            while (queue != outbound.end() && !queue->second.packets.empty())
+            {
+                if (!stopping && buffered[i] >= MaxBufferedBytes)
+                {
+                    backedUp = true;
+                    break;
+                }
+
+                OutboundPacket& packet = queue->second.packets.front();
+                buffered[i] += packet.data->GetNumberOfBytesUsed();
+                queue->second.bytes -= packet.data->GetNumberOfBytesUsed();
+                batch.emplace_back(destinations[i], std::move(packet));
+                queue->second.packets.pop_front();
+            }
+        }
+
+        lock.unlock();
+        for (const auto& pair : batch)
+        {
+            const OutboundPacket& packet = pair.second;
+            if (node->Send(packet.data.get(), packet.priority, packet.reliability, packet.channel, pair.first, false) == 0)
+            {
+                Log::writeToLog(Log::ERR, "Unable to send message with type:", (uint32_t)packet.data->GetData()[0],
+                    " to system ", pair.first);
+            }
+        }
+        batch.clear();
+        lock.lock();
+
+        if (stopping)
+        {
+            return;
+        }
+
+        // A backed up node is checked again shortly, as RakNet does not say when it catches up
+        if (backedUp)
+        {
+            outboundReady.wait_for(lock, std::chrono::milliseconds(2), [this] { return outboundPending || stopSending; });
+        } else {
+            outboundReady.wait(lock, [this] { return outboundPending || stopSending; });
+        }
     }
 }
 
+void Network::limitOutgoingBandwidth(unsigned maxBitsPerSecond)
+{
+    Log::writeToLog(Log::INFO, "Limiting outgoing bandwidth to ", maxBitsPerSecond, " bits/s per connection");
+    node->SetPerConnectionOutgoingBandwidthLimit(maxBitsPerSecond);
+}
+
+size_t Network::queuedBytes(RakNet::RakNetGUID destination)
+{
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    auto it = outbound.find(destination);
+    return it == outbound.end() ? 0 : it->second.bytes;
+}
+
+uint64_t Network::getDroppedSnapshots() const
+{
+    return droppedSnapshots.load();
+}
+
 /*!
  * Templated function that attempts to call a given function pointer
  * on each entry in a vector, assuming the function pointer returns a bool.
@@ -134,15 +450,24 @@ void Network::sendMessage(RakNet::RakNetGUID destination, MessageInterface* mess
  * The first entry in the vector that returns true "captures" the event, preventing future
  * modules from being informed about the event.
  *
+ * Callers pass in the current snapshot of the callback set, so callbacks that
+ * (de)register other callbacks do not disturb the iteration, and the callbacks
+ * deregistered since, which are skipped.
+ *
  * Returns true if the event was handled, false if it was not. There might be different
  * relevant error states. Not handeling a information event may only be a warning,
  * whereas not handling a syncronization event could be fatal.
  */
 template <typename T, typename ...Types>
-bool tryCallbacks(std::set<ReceiveInterface*>& interfaces, T func, Types... args)
+bool tryCallbacks(const std::set<ReceiveInterface*>& interfaces, const std::set<ReceiveInterface*>& removed,
+    T func, Types... args)
 {
     for (auto it : interfaces)
     {
+        if (removed.count(it) > 0)
+        {
+            continue;
+        }
         if ((it->*func)(args...))
         {
             // We handled it! Stop trying handlers.
@@ -152,6 +477,34 @@ bool tryCallbacks(std::set<ReceiveInterface*>& interfaces, T func, Types... args
     return false;
 }
 
+template <typename T, typename ...Types>
+bool Network::dispatchCallbacks(T func, Types... args)
+{
+    std::shared_ptr<const std::set<ReceiveInterface*>> current;
+    {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        current = std::atomic_load(&callbacks);
+        dispatchGeneration = callbackGeneration;
+    }
+
+    bool handled = tryCallbacks(*current, removedThisDispatch, func, args...);
+
+    {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        dispatchGeneration = 0;
+    }
+    removedThisDispatch.clear();
+    dispatchDone.notify_all();
+    return handled;
+}
+
+void Network::simulateLossyLink(float packetLoss, unsigned short extraPing, unsigned short extraPingVariance)
+{
+    Log::writeToLog(Log::INFO, "Simulating a link with ", packetLoss * 100, "% packet loss and ", extraPing,
+        "+", extraPingVariance, " ms extra ping");
+    node->ApplyNetworkSimulator(packetLoss, extraPing, extraPingVariance);
+}
+
 RakNet::RakNetGUID Network::getOurGUID()
 {
     if (node)
@@ -163,6 +516,7 @@ RakNet::RakNetGUID Network::getOurGUID()
 
 RakNet::RakNetGUID Network::getFirstConnectionGUID()
 {
+    std::lock_guard<std::mutex> lock(connectionMutex);
     if (confirmedConnections.size() > 0)
     {
         return *confirmedConnections.begin();
@@ -173,6 +527,10 @@ RakNet::RakNetGUID Network::getFirstConnectionGUID()
 
 void Network::handlePackets()
 {
+    uint64_t seenSignal = currentPacketSignal();
+    std::chrono::steady_clock::time_point pollUntil;
+    std::chrono::steady_clock::time_point missingUntil;
+    std::chrono::microseconds pollInterval(0);
     while (true)
     {
         /* Check for shutdown inside a locked mutex */
@@ -183,10 +541,27 @@ void Network::handlePackets()
                 return;
             }
         }
-        /* Sleep so we don't busy loop */
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        /*
+         * Block until a datagram arrives instead of sleeping, so packets are handled as soon
+         * as they come in. RakNet signals a datagram before its update thread has turned it
+         * into a packet, and has no hook for after, so once a datagram arrives we look for
+         * its packet again for a short while, then every MaxMissingPacketWait. The count is
+         * read before draining, so a datagram arriving meanwhile is not missed.
+         */
+        uint64_t signal = currentPacketSignal();
+        if (signal != seenSignal)
+        {
+            seenSignal = signal;
+            pollUntil = std::chrono::steady_clock::now() + DatagramPollWindow;
+            missingUntil = pollUntil + MaxPacketWait;
+            pollInterval = std::chrono::microseconds(0);
+        }
+
+        uint32_t received = 0;
         for (RakNet::Packet* packet = node->Receive(); packet; node->DeallocatePacket(packet), packet = node->Receive())
         {
+            ++received;
             RakNet::BitStream packetBs(packet->data + 1, packet->length - 1, false);
             switch (packet->data[0])
             {
@@ -199,7 +574,7 @@ void Network::handlePackets()
 
                 out.Write((RakNet::MessageID)ID_VERSION);
                 ourVersion.serialize(out);
-                node->Send(&out, HIGH_PRIORITY, RELIABLE, 0, packet->guid, false);
+                node->Send(&out, HIGH_PRIORITY, RELIABLE, Channels::Control, packet->guid, false);
                 break;
             }
 
@@ -212,7 +587,7 @@ void Network::handlePackets()
 
                 out.Write((RakNet::MessageID)ID_VERSION);
                 ourVersion.serialize(out);
-                node->Send(&out, HIGH_PRIORITY, RELIABLE, 0, packet->guid, false);
+                node->Send(&out, HIGH_PRIORITY, RELIABLE, Channels::Control, packet->guid, false);
                 break;
             }
 
@@ -231,7 +606,7 @@ void Network::handlePackets()
 
                     out.Write((RakNet::MessageID)ID_VERSION_MISMATCH);
                     ourVersion.serialize(out);
-                    node->Send(&out, IMMEDIATE_PRIORITY, RELIABLE, 0, packet->guid, false);
+                    node->Send(&out, IMMEDIATE_PRIORITY, RELIABLE, Channels::Control, packet->guid, false);
 
                     // hangup nicely
                     node->CloseConnection(packet->guid, true);
@@ -240,11 +615,14 @@ void Network::handlePackets()
                 }
 
                 /* Add this system to the verified connection list */
-                confirmedConnections.insert(packet->guid);
+                {
+                    std::lock_guard<std::mutex> lock(connectionMutex);
+                    confirmedConnections.insert(packet->guid);
+                }
 
 
                 /* We successfully connected! Inform any waiting callbacks */
-                if (!tryCallbacks(callbacks, &ReceiveInterface::ConnectionEstablished, packet->guid))
+                if (!dispatchCallbacks(&ReceiveInterface::ConnectionEstablished, packet->guid))
                 {
                     Log::writeToLog(Log::WARN, "ConnectionEstablished callback not handled!");
                 }
@@ -264,14 +642,14 @@ void Network::handlePackets()
             case ID_DISCONNECTION_NOTIFICATION:
             {
                 Log::writeToLog(Log::L_DEBUG, "System GUID:", packet->guid, " disconnected gracefully.");
-                // Remove this from our confirmed connections list
-                auto foundIt = confirmedConnections.find(packet->guid);
-                if (foundIt != confirmedConnections.end())
+                // Remove this from our confirmed connections list, dropping anything still queued for it
                 {
-                    confirmedConnections.erase(foundIt);
+                    std::lock_guard<std::mutex> lock(connectionMutex);
+                    confirmedConnections.erase(packet->guid);
+                    outbound.erase(packet->guid);
                 }
 
-                if (!tryCallbacks(callbacks, &ReceiveInterface::ConnectionLost, packet->guid))
+                if (!dispatchCallbacks(&ReceiveInterface::ConnectionLost, packet->guid))
                 {
                     Log::writeToLog(Log::WARN, "ConnectionLost callback not handled!");
                 }
@@ -281,14 +659,14 @@ void Network::handlePackets()
             case ID_CONNECTION_LOST:
             {
                 Log::writeToLog(Log::L_DEBUG, "System GUID:", packet->guid, " disconnected rudely.");
-                // Remove this from our confirmed connections list
-                auto foundIt = confirmedConnections.find(packet->guid);
-                if (foundIt != confirmedConnections.end())
+                // Remove this from our confirmed connections list, dropping anything still queued for it
                 {
-                    confirmedConnections.erase(foundIt);
+                    std::lock_guard<std::mutex> lock(connectionMutex);
+                    confirmedConnections.erase(packet->guid);
+                    outbound.erase(packet->guid);
                 }
 
-                if (!tryCallbacks(callbacks, &ReceiveInterface::ConnectionLost, packet->guid))
+                if (!dispatchCallbacks(&ReceiveInterface::ConnectionLost, packet->guid))
                 {
                     Log::writeToLog(Log::WARN, "ConnectionLost callback not handled!");
                 }
@@ -299,7 +677,7 @@ void Network::handlePackets()
             {   
                 LobbyStatusRequest newRequest(packetBs);
 
-                if (!tryCallbacks(callbacks, &ReceiveInterface::LobbyStatusRequested, packet->guid, newRequest))
+                if (!dispatchCallbacks(&ReceiveInterface::LobbyStatusRequested, packet->guid, newRequest))
                 {
                     Log::writeToLog(Log::ERR, "Incoming LobbyStatusRequest not handled!");
                     throw NetworkMessageUnhandledError("LobbyStatusRequested not handled!");
@@ -310,7 +688,7 @@ void Network::handlePackets()
             case ID_LOBBY_STATUS:
             {
                 LobbyStatus newStatus(packetBs);
-                if (!tryCallbacks(callbacks, &ReceiveInterface::UpdatedLobbyStatus, newStatus))
+                if (!dispatchCallbacks(&ReceiveInterface::UpdatedLobbyStatus, newStatus))
                 {
                     Log::writeToLog(Log::ERR, "Got unexpected/unhandled LobbyStatus!");
                     throw NetworkMessageUnhandledError("UpdatedLobbyStatus not handled!");
@@ -321,7 +699,14 @@ void Network::handlePackets()
             case ID_ENVELOPE:
             {
                 // creation of the envelope will automatically add the event to the queue if possible
-                EnvelopeMessage eventMessage(packetBs, packet->guid);
+                EnvelopeMessage eventMessage(packetBs, packet->guid, eventSystem.load());
+                break;
+            }
+
+            case ID_ENVELOPE_BUNDLE:
+            {
+                // Likewise, every event in the bundle is queued in order
+                EnvelopeBundle bundle(packetBs, packet->guid, eventSystem.load());
                 break;
             }
 
@@ -330,5 +715,30 @@ void Network::handlePackets()
                 break;
             }
         }
+
+        if (received > 0)
+        {
+            pollUntil = missingUntil = std::chrono::steady_clock::time_point();
+        }
+        else if (std::chrono::steady_clock::now() < pollUntil)
+        {
+            // The update thread usually takes well under the window, so look again soon, then less often
+            if (pollInterval.count() == 0)
+            {
+                std::this_thread::yield();
+                pollInterval = std::chrono::microseconds(16);
+            } else {
+                std::this_thread::sleep_for(pollInterval);
+                pollInterval = std::min(pollInterval * 2, MaxDatagramPollInterval);
+            }
+        }
+        else if (std::chrono::steady_clock::now() < missingUntil)
+        {
+            waitForPacketSignal(seenSignal, MaxMissingPacketWait);
+        }
+        else
+        {
+            waitForPacketSignal(seenSignal, MaxPacketWait);
+        }
     }
 }
@@ -1,19 +1,32 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <string> // For std::string
 #include <set>
 #include <thread>
 #include <mutex>
 
 #include <iostream>
+#include <memory>
 
 #include "RakNetTypes.h" // For RakNetGUID
 #include "PacketPriority.h" // For PacketReliability
 
-/// Forward definition of RakPeerInterface
+#include "Globals.h" // For NETWORK_SERVER_PORT
+
+/// Forward definition of RakPeerInterface, BitStream and RakNet's socket types
 namespace RakNet
 {
     class RakPeerInterface;
+    class BitStream;
+    class RakNetSocket2;
+    struct RNS2RecvStruct;
 }
 
 /// Forward declaration of LobbyStatus
@@ -27,6 +40,12 @@ class Network;
 /// Forward declaration of MessageInterface
 class MessageInterface;
 
+/// Forward declaration of EventSystem
+class EventSystem;
+
+/// Forward declaration of DeliveryPolicy
+struct DeliveryPolicy;
+
 /*!
  * Definition of an ostream override so that we can easily log
  * RakNetGUID's
@@ -95,32 +114,90 @@ public:
  * away the RakNet internals from the rest of the program. This allows us to make
  * some choices, such as network transport layer reliability, and have them not
  * affect the other clients.
+ *
+ * Messages are serialized by the thread sending them, then queued per destination and
+ * handed to RakNet by a send thread, so no caller waits on RakNet. The send thread only
+ * hands RakNet more for a node while RakNet holds less than MaxBufferedBytes unsent for
+ * it. If a slow node's queue then grows past MaxQueuedBytes, its oldest unreliable
+ * messages (snapshots, which newer ones replace) are dropped; reliable ones are kept.
+ *
+ * All public functions are thread-safe.
  */
 class Network
 {
 public:
-    /// Starts up the internal RakNet interface, either in server or client mode
-    Network(bool is_server = false);
+    /// Bytes queued for one node past which its oldest unsent snapshots are dropped
+    constexpr static size_t MaxQueuedBytes = 64 * 1024;
+
+    /// Bytes RakNet may hold unsent for one node before the send thread stops handing it more
+    constexpr static size_t MaxBufferedBytes = 32 * 1024;
+
+    /**
+     * Starts up the internal RakNet interface, either in server or client mode.
+     * Servers listen on the given port, so several can run on one machine.
+     */
+    Network(bool is_server = false, unsigned short port = NETWORK_SERVER_PORT);
 
     /// Shuts down the network connection on exit
     ~Network();
 
     /// Connects to a game master given a hostname or IP as a string
-    void connect(const std::string& hostname);
+    void connect(const std::string& hostname, unsigned short port = NETWORK_SERVER_PORT);
+
+    /**
+     * Sets the EventSystem that received envelopes are queued in. Called by the EventSystem
+     * that is given this Network. If unset, envelopes go to the global EventSystem.
+     */
+    void setEventSystem(EventSystem* eventSystem_);
 
     /// Adds a callback class to the registered callback list
     void registerCallback(ReceiveInterface* callback);
 
-    /// Removes a callback class from the registered callback list
+    /**
+     * Removes a callback class from the registered callback list. Once this returns the
+     * callback is no longer called, and can be destroyed: unless called from a callback,
+     * it waits for the receive thread to finish any call it is making to the old list.
+     */
     void deregisterCallback(ReceiveInterface* callback);
 
     /**
-     * Sends a message to the specified client.
-     * Throws an InvalidDestinationError if the GUID given isn't a 'confirmed' connection
+     * Queues a message for the specified client.
+     * Throws an InvalidDestinationError if the GUID given isn't a 'confirmed' connection.
+     * Failures to send after that are logged by the send thread.
      *
      * Takes a polymorphic type that inherits from MessageInterface
      */
-    void sendMessage(RakNet::RakNetGUID destination, MessageInterface* message, PacketReliability reliability);
+    void sendMessage(RakNet::RakNetGUID destination, const MessageInterface* message, PacketReliability reliability);
+
+    /// Like sendMessage above, but with the given priority and ordering channel too
+    void sendMessage(RakNet::RakNetGUID destination, const MessageInterface* message, const DeliveryPolicy& policy);
+
+    /**
+     * Queues a message for each of the specified clients, serializing it only once.
+     * Throws an InvalidDestinationError, before sending anything, if any GUID given
+     * isn't a 'confirmed' connection
+     */
+    void broadcastMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+        PacketReliability reliability);
+
+    /// Like broadcastMessage above, but with the given priority and ordering channel too
+    void broadcastMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+        const DeliveryPolicy& policy);
+
+    /**
+     * Makes RakNet drop the given fraction of outgoing datagrams and delay the rest, to test
+     * behaviour on a poor link. Only has an effect in RakNet builds with its network simulator.
+     */
+    void simulateLossyLink(float packetLoss, unsigned short extraPing = 0, unsigned short extraPingVariance = 0);
+
+    /// Limits how fast RakNet sends to each node, to test behaviour with a slow node
+    void limitOutgoingBandwidth(unsigned maxBitsPerSecond);
+
+    /// Returns how many bytes are queued for a node, not yet handed to RakNet
+    size_t queuedBytes(RakNet::RakNetGUID destination);
+
+    /// Returns how many snapshots were dropped from the queues of slow nodes
+    uint64_t getDroppedSnapshots() const;
 
     /// Returns our own RakNetGUID
     RakNet::RakNetGUID getOurGUID();
@@ -136,8 +213,33 @@ private:
     /// Member thread that handles recieving messages from the queue.
     std::thread recieveThread;
 
-    /// Member variables storing all currently registered callbacks
-    std::set<ReceiveInterface*> callbacks;
+    /// EventSystem that received envelopes are delivered to, or nullptr for the global one
+    std::atomic<EventSystem*> eventSystem;
+
+    /**
+     * Member variables storing all currently registered callbacks. The set is replaced rather
+     * than modified, so callbacks can register or deregister others while being called.
+     * Read and replaced with std::atomic_load/atomic_store; replaced under callbackMutex and dispatchMutex.
+     */
+    std::shared_ptr<const std::set<ReceiveInterface*>> callbacks;
+
+    /// Serializes changes to the callback set
+    std::mutex callbackMutex;
+
+    /// Generation of the callback set, bumped whenever it is replaced. Protected by dispatchMutex
+    uint64_t callbackGeneration;
+
+    /// Generation of the callback set the receive thread is calling, or 0 between dispatches. Protected by dispatchMutex
+    uint64_t dispatchGeneration;
+
+    /// Protects callbackGeneration and dispatchGeneration, and replacing the callback set
+    std::mutex dispatchMutex;
+
+    /// Signalled at the end of every dispatch to the callbacks
+    std::condition_variable dispatchDone;
+
+    /// Callbacks deregistered by a callback during the current dispatch, and possibly destroyed. Receive thread only
+    std::set<ReceiveInterface*> removedThisDispatch;
 
     /// Member variable indicating when the networking thread should shutdown, along with protective mutex
     std::mutex shutdownMutex;
@@ -149,9 +251,88 @@ private:
      */
     std::set<RakNet::RakNetGUID> confirmedConnections;
 
+    /// A serialized message waiting to be handed to RakNet
+    struct OutboundPacket
+    {
+        /// Shared by every destination of a broadcast
+        std::shared_ptr<const RakNet::BitStream> data;
+        PacketReliability reliability;
+        PacketPriority priority;
+        char channel;
+    };
+
+    /// Messages waiting for one node, oldest first
+    struct OutboundQueue
+    {
+        OutboundQueue() : bytes(0) {}
+
+        std::deque<OutboundPacket> packets;
+        size_t bytes;
+    };
+
+    /// Outbound queue of every confirmed connection
+    std::map<RakNet::RakNetGUID, OutboundQueue> outbound;
+
+    /// Guards confirmedConnections, outbound, outboundPending and stopSending. Never held while calling RakNet
+    std::mutex connectionMutex;
+
+    /// Signalled when a message is queued, or the send thread should stop
+    std::condition_variable outboundReady;
+
+    /// Set when a message is queued, until the send thread next looks at the queues
+    bool outboundPending;
+
+    /// Set when the send thread should hand RakNet what is left and stop
+    bool stopSending;
+
+    std::atomic<uint64_t> droppedSnapshots;
+
+    /// Member thread that hands queued messages to RakNet
+    std::thread sendThread;
+
+    /// Serializes a message, before any lock is taken, so it can be queued for each destination
+    static std::shared_ptr<const RakNet::BitStream> serializeMessage(const MessageInterface* message);
+
+    /// Validates the destinations, then queues the serialized message for each
+    void queueMessage(const std::set<RakNet::RakNetGUID>& destinations, const MessageInterface* message,
+        std::shared_ptr<const RakNet::BitStream> data, PacketReliability reliability, PacketPriority priority, char channel);
+
+    /// Drops the oldest unreliable messages of a queue until it fits in MaxQueuedBytes. Call with connectionMutex held
+    void dropStaleSnapshots(OutboundQueue& queue);
+
+    /// Returns how many bytes RakNet holds unsent for a node. Call without connectionMutex held
+    double bufferedBytes(RakNet::RakNetGUID destination);
+
+    /// Replaces the callback set, returning its generation. Call with callbackMutex held
+    uint64_t publishCallbacks(std::shared_ptr<std::set<ReceiveInterface*>>&& updated);
+
+    /// Calls func on each registered callback until one handles it. Receive thread only
+    template <typename T, typename ...Types>
+    bool dispatchCallbacks(T func, Types... args);
+
+    /// Counts datagrams arriving at our sockets, so the receive thread can wait for the next. Protected by packetSignalMutex
+    uint64_t packetSignalCount;
+    std::mutex packetSignalMutex;
+    std::condition_variable packetSignal;
+
+    /// Called by RakNet's socket thread for every incoming datagram, before it is processed. Wakes the owning Network
+    static bool onIncomingDatagram(RakNet::RNS2RecvStruct* datagram);
+
+    /// Wakes the receive thread if it is waiting in waitForPacketSignal
+    void signalPackets();
+
+    /// Returns the current signal count, to pass to waitForPacketSignal
+    uint64_t currentPacketSignal();
+
+    /// Waits until the signal count moves on from seen, or the timeout passes. Returns true if it moved on
+    bool waitForPacketSignal(uint64_t seen, std::chrono::milliseconds timeout);
+
     /**
      * Main thread function. This handles packets as they come in, and notifies
      * registered callbacks of any changes.
      */
     void handlePackets();
+
+    /// Send thread function. Hands queued messages to RakNet while it is keeping up
+    void sendPackets();
 };
@@ -6,6 +6,7 @@
 #include "EventID.h"
 #include "Stations.h"
 #include "EventSystem.h"
+#include "EventCodec.h" // For masked()
 
 #include "RakNetTypes.h" // For RakNetGUID
 
@@ -34,10 +35,23 @@ public:
         uint32_t team;
         uint32_t unit;
         StationType station;
+
+        template <typename Self, typename Visitor>
+        static void fields(Self& self, Visitor& visit)
+        {
+            visit(self.team, self.unit, self.station);
+        }
     };
 
     std::vector<Station> stations;
     std::map<uint32_t, std::string> teamNames;
+
+    /// Lists the fields sent over the network, in wire order. See EventCodec.h
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.stations, self.teamNames);
+    }
 };
 
 /*!
@@ -86,6 +100,12 @@ struct Flag
 {
     uint32_t team;
     uint32_t index;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.index);
+    }
 };
 
 /*!
@@ -98,6 +118,11 @@ public:
     UnitState() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::UnitState;
+    constexpr static EventPriority priority = EventPriority::Low;
+    constexpr static bool coalesce = true;
+
+    /// Only the newest state of each unit matters
+    uint32_t coalesceKey() const { return (team << 16) | unit; }
 
     uint32_t team;
     uint32_t unit;
@@ -185,6 +210,83 @@ public:
     bool hasFlag;
 
     Flag flag;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit,
+            self.tubeIsArmed, self.tubeOccupancy, self.remainingTorpedos, self.remainingMines, self.torpedoDistance,
+            self.x, self.y, self.depth, self.heading, self.direction, self.pitch,
+            self.speed, self.desiredSpeed,
+            self.powerAvailable, self.powerUsage, self.isStealth, self.stealthCooldown,
+            self.respawning, self.respawnCooldown,
+            self.yawEnabled, self.pitchEnabled, self.engineEnabled, self.commsEnabled, self.sonarEnabled,
+            self.weaponsEnabled,
+            self.targetIsLocked, self.targetTeam, self.targetUnit,
+            self.hasFlag, self.flag);
+    }
+};
+
+
+/*!
+ * Sent by the game master in place of a UnitState. Carries only the fields that changed
+ * since a baseline state the client has acknowledged, or every field if baseline is 0.
+ * Clients rebuild the full UnitState with a UnitStateDeltaReceiver (see UnitStateDelta.h).
+ */
+class UnitStateDelta : public Event
+{
+public:
+    UnitStateDelta() : Event(category, id) {}
+    constexpr static uint32_t category = Events::Category::Simulation;
+    constexpr static uint32_t id = Events::Sim::UnitStateDelta;
+    constexpr static EventPriority priority = EventPriority::Low;
+
+    uint32_t team;
+    uint32_t unit;
+
+    /// Counts up from 1 for each state sent to this client for this unit
+    uint32_t sequence;
+
+    /// Sequence number of the state this one is relative to, or 0 for a full state
+    uint32_t baseline;
+
+    /// Bit i is set if the i-th field in UnitState::fields is included
+    uint64_t mask;
+
+    /// Only the fields selected by mask are meaningful
+    UnitState state;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.sequence, self.baseline, masked(self.state, self.mask));
+    }
+};
+
+/*!
+ * Sent by clients for each UnitStateDelta they apply, so the game master can use that
+ * state as the next baseline. A sequence of 0 asks for a full state instead.
+ */
+class UnitStateAck : public Event
+{
+public:
+    UnitStateAck() : Event(category, id) {}
+    constexpr static uint32_t category = Events::Category::Simulation;
+    constexpr static uint32_t id = Events::Sim::UnitStateAck;
+    constexpr static EventPriority priority = EventPriority::Low;
+
+    uint32_t team;
+    uint32_t unit;
+    uint32_t sequence;
+
+    /// Set on arrival to the node the acknowledgement came from
+    RakNet::RakNetGUID sender;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.sequence);
+    }
 };
 
 
@@ -198,12 +300,18 @@ typedef uint32_t FlagID;
 struct TorpedoState
 {
     /// Stores the location of the torpedo.
-    int64_t x, y, depth;
+    int64_t x, y;
 
     /// Stores the current heading of the torpedo in degrees.
     uint16_t heading;
 
     // All torpedos travel at the same speed; we don't have a speed entry here because of this
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(position(self.x, Axis::X), position(self.y, Axis::Y), packed(self.heading, 9));
+    }
 };
 
 /*!
@@ -212,7 +320,13 @@ struct TorpedoState
 struct MineState
 {
     /// Just store the location of mines; they don't move
-    int64_t x, y, depth;
+    int64_t x, y;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(position(self.x, Axis::X), position(self.y, Axis::Y));
+    }
 };
 
 /*!
@@ -224,10 +338,16 @@ struct FlagState
     uint32_t team;
 
     /// Store location of flags
-    int64_t x, y, depth;
+    int64_t x, y;
 
     /// Stores if the flag has been taken
     bool isTaken;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, position(self.x, Axis::X), position(self.y, Axis::Y), self.isTaken);
+    }
 };
 
 /*!
@@ -238,7 +358,7 @@ struct UnitSonarState
     uint32_t team;
     uint32_t unit;
 
-    int64_t x, y, depth;
+    int64_t x, y;
     uint16_t heading;
 
     uint16_t speed;
@@ -252,6 +372,17 @@ struct UnitSonarState
     uint16_t respawnCooldown;
 
     bool hasFlag;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit,
+            position(self.x, Axis::X), position(self.y, Axis::Y),
+            packed(self.heading, 9), self.speed, self.power,
+            self.hasFlag,
+            self.isStealth, self.stealthCooldown,
+            self.respawning, self.respawnCooldown);
+    }
 };
 
 
@@ -262,14 +393,25 @@ struct UnitSonarState
 class SonarDisplayState : public Event
 {
 public:
-    SonarDisplayState() : Event(category, id) {}
+    SonarDisplayState() : Event(category, id), mapWidth(0), mapHeight(0) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::SonarDisplay;
+    constexpr static EventPriority priority = EventPriority::Low;
+    constexpr static bool coalesce = true;
+
+    /// Map size in world units, which positions are quantized against
+    uint32_t mapWidth, mapHeight;
 
     std::vector<UnitSonarState> units;
     std::vector<TorpedoState> torpedos;
     std::vector<MineState> mines;
     std::vector<FlagState> flags;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(bounds(self.mapWidth, self.mapHeight), self.units, self.torpedos, self.mines, self.flags);
+    }
 };
 
 class ThrottleEvent : public Event
@@ -278,10 +420,17 @@ public:
     ThrottleEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Throttle;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team;
     uint32_t unit;
     uint16_t desiredSpeed;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.desiredSpeed);
+    }
 };
 
 /*!
@@ -294,6 +443,7 @@ public:
     TubeLoadEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::TubeLoad;
+    constexpr static EventPriority priority = EventPriority::High;
 
     enum AmmoType
     {
@@ -305,6 +455,12 @@ public:
     uint32_t unit;
     uint16_t tube;
     AmmoType type;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.tube, self.type);
+    }
 };
 
 /*!
@@ -317,11 +473,18 @@ public:
     TubeArmEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::TubeArm;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team;
     uint32_t unit;
     uint16_t tube;
     bool isArmed;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.tube, self.isArmed);
+    }
 };
 
 /*!
@@ -333,6 +496,7 @@ public:
     SteeringEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Steering;
+    constexpr static EventPriority priority = EventPriority::High;
 
     enum Direction
     {
@@ -344,6 +508,12 @@ public:
     uint32_t unit;
     Direction direction;
     bool isPressed;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.direction, self.isPressed);
+    }
 };
 
 /*! 
@@ -355,9 +525,16 @@ public:
     FireEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Fire;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team;
     uint32_t unit;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit);
+    }
 };
 
 /*! 
@@ -369,10 +546,17 @@ public:
     RangeEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Range;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team;
     uint32_t unit;
     uint16_t range;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.range);
+    }
 };
 
 /*!
@@ -384,6 +568,7 @@ public:
     PowerEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Power;
+    constexpr static EventPriority priority = EventPriority::High;
 
     enum System
     {
@@ -399,6 +584,12 @@ public:
     uint32_t unit;
     System system;
     bool isOn;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.system, self.isOn);
+    }
 };
 
 /*!
@@ -410,10 +601,17 @@ public:
     StealthEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Stealth;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team;
     uint32_t unit;
     bool isStealth;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.isStealth);
+    }
 };
 
 /*!
@@ -428,6 +626,12 @@ public:
 
     int64_t x, y;
     int16_t size;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.x, self.y, self.size);
+    }
 };
 
 /*!
@@ -436,11 +640,65 @@ public:
 class ConfigEvent : public Event
 {
 public:
-    ConfigEvent() : Event(category, id) {}
+    ConfigEvent() : Event(category, id), terrainHash(0) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Config;
 
+    /**
+     * If nonzero, the terrainHash() of the terrain, whose map is left out of config.
+     * Clients load it from their TerrainCache, or ask for it with a TerrainRequest.
+     */
+    uint64_t terrainHash;
+
     Config config;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.terrainHash, self.config);
+    }
+};
+
+/*!
+ * Sent by clients that do not have the terrain a ConfigEvent named in their cache
+ */
+class TerrainRequest : public Event
+{
+public:
+    TerrainRequest() : Event(category, id) {}
+    constexpr static uint32_t category = Events::Category::Simulation;
+    constexpr static uint32_t id = Events::Sim::TerrainRequest;
+
+    uint64_t hash;
+
+    /// Set on arrival to the node the request came from
+    RakNet::RakNetGUID sender;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.hash);
+    }
+};
+
+/*!
+ * The game master's answer to a TerrainRequest
+ */
+class TerrainData : public Event
+{
+public:
+    TerrainData() : Event(category, id) {}
+    constexpr static uint32_t category = Events::Category::Simulation;
+    constexpr static uint32_t id = Events::Sim::TerrainData;
+
+    uint64_t hash;
+    Terrain terrain;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.hash, self.terrain);
+    }
 };
 
 /*!
@@ -452,8 +710,16 @@ public:
     ScoreEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::Score;
+    constexpr static EventPriority priority = EventPriority::Low;
+    constexpr static bool coalesce = true;
     
     std::map<uint32_t, uint32_t> scores;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.scores);
+    }
 };
 
 /*!
@@ -465,6 +731,7 @@ public:
     StatusUpdateEvent() : Event(category, id) {}
     constexpr static uint32_t category = Events::Category::Simulation;
     constexpr static uint32_t id = Events::Sim::StatusUpdate;
+    constexpr static EventPriority priority = EventPriority::High;
 
     uint32_t team; // team referes to team of sub or owner of flag
     uint32_t unit;
@@ -479,4 +746,10 @@ public:
     };
 
     Type type;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.team, self.unit, self.type);
+    }
 };
@@ -0,0 +1,109 @@
+#include "TerrainCache.h"
+
+#include "EventCodec.h"
+#include "Exceptions.h"
+#include "Log.h"
+
+#include "BitStream.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/// FNV-1a, over the bytes of a value
+static void hashValue(uint64_t& hash, uint32_t value)
+{
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+}
+
+uint64_t terrainHash(const Terrain& terrain)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hashValue(hash, terrain.width);
+    hashValue(hash, terrain.height);
+    hashValue(hash, terrain.scale);
+    hashValue(hash, terrain.map.size());
+
+    // Walls, 32 cells at a time
+    uint32_t bits = 0;
+    for (size_t i = 0; i < terrain.map.size(); ++i)
+    {
+        bits |= (uint32_t)(terrain.map[i] == Terrain::WALL) << (i % 32);
+        if (i % 32 == 31 || i + 1 == terrain.map.size())
+        {
+            hashValue(hash, bits);
+            bits = 0;
+        }
+    }
+
+    // 0 means "no hash" in a ConfigEvent
+    return hash == 0 ? 1 : hash;
+}
+
+TerrainCache::TerrainCache(const std::string& directory_)
+    : directory(directory_)
+{}
+
+std::string TerrainCache::path(uint64_t hash) const
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string name = "terrain_";
+    for (int32_t i = 60; i >= 0; i -= 4)
+    {
+        name += digits[(hash >> i) & 0xF];
+    }
+    return directory + "/" + name + ".cache";
+}
+
+bool TerrainCache::load(uint64_t hash, Terrain& terrain) const
+{
+    std::ifstream file(path(hash), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Terrain cached;
+    try
+    {
+        RakNet::BitStream stream((unsigned char*)data.data(), data.size(), false);
+        FieldReader reader(stream);
+        Terrain::fields(cached, reader);
+    }
+    catch (NetworkMessageError&)
+    {
+        Log::writeToLog(Log::WARN, "Cached terrain ", path(hash), " could not be read; ignoring it");
+        return false;
+    }
+
+    if (terrainHash(cached) != hash)
+    {
+        Log::writeToLog(Log::WARN, "Cached terrain ", path(hash), " does not match its hash; ignoring it");
+        return false;
+    }
+
+    terrain = std::move(cached);
+    return true;
+}
+
+void TerrainCache::store(const Terrain& terrain) const
+{
+    RakNet::BitStream stream;
+    FieldWriter writer(stream);
+    Terrain::fields(terrain, writer);
+
+    std::string filename = path(terrainHash(terrain));
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write((const char*)stream.GetData(), stream.GetNumberOfBytesUsed());
+    if (!file)
+    {
+        Log::writeToLog(Log::WARN, "Unable to cache terrain in ", filename);
+        return;
+    }
+    Log::writeToLog(Log::L_DEBUG, "Cached terrain in ", filename);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ConfigParser.h" // for Terrain
+
+/*!
+ * Content hash of a terrain, covering exactly what is sent over the network: its size,
+ * scale and which cells are walls. Never 0.
+ */
+uint64_t terrainHash(const Terrain& terrain);
+
+/*!
+ * On-disk cache of terrains received from game masters, keyed by terrainHash(), so that
+ * a map that has been played before does not have to be downloaded again.
+ *
+ * Each terrain is kept in its own file, in the same encoding it is sent with.
+ */
+class TerrainCache
+{
+public:
+    /// Caches terrains in the given directory, which must already exist
+    TerrainCache(const std::string& directory_ = "data");
+
+    /// Loads the terrain with the given hash into terrain. Returns false if it is not cached (or is damaged)
+    bool load(uint64_t hash, Terrain& terrain) const;
+
+    /// Saves a terrain under its hash. Failing to save is logged, but not an error
+    void store(const Terrain& terrain) const;
+
+    /// Returns the file a terrain with the given hash is cached in
+    std::string path(uint64_t hash) const;
+
+private:
+    std::string directory;
+};
@@ -0,0 +1,86 @@
+#include "TickBundler.h"
+
+#include "Exceptions.h"
+#include "Log.h"
+
+#include <algorithm>
+
+constexpr size_t TickBundler::MaxBundleBytes;
+
+TickBundler::TickBundler(EventSystem* eventSystem_)
+    : eventSystem(eventSystem_)
+{}
+
+void TickBundler::add(const Event& event, RakNet::RakNetGUID destination)
+{
+    serialize(event);
+    append(event, destination);
+}
+
+void TickBundler::add(const Event& event, const std::set<RakNet::RakNetGUID>& destinations)
+{
+    serialize(event);
+    for (const RakNet::RakNetGUID& destination : destinations)
+    {
+        append(event, destination);
+    }
+}
+
+void TickBundler::flush()
+{
+    // Taken out first, so a failed send cannot leave this tick's bundles to be sent again next tick
+    std::map<RakNet::RakNetGUID, std::vector<EnvelopeBundle>> sending;
+    sending.swap(bundles);
+
+    for (auto& pair : sending)
+    {
+        try
+        {
+            for (const EnvelopeBundle& bundle : pair.second)
+            {
+                eventSystem->queueBundle(bundle, pair.first);
+            }
+        }
+        catch (InvalidDestinationError&)
+        {
+            // The node disconnected during the tick; the others still get theirs
+            Log::writeToLog(Log::WARN, "Dropped bundles for node ", RakNet::RakNetGUID::ToUint32(pair.first),
+                ", which is no longer connected");
+        }
+    }
+}
+
+const std::vector<EnvelopeBundle>& TickBundler::pending(RakNet::RakNetGUID destination)
+{
+    return bundles[destination];
+}
+
+void TickBundler::serialize(const Event& event)
+{
+    payload.Reset();
+    if (!EnvelopeMessage::serializeEvent(event, payload))
+    {
+        Log::writeToLog(Log::ERR, "Attempted to bundle an event of category=", event.i_category, " and id=", event.i_id,
+            ", but no serialization code defined!");
+        throw EnvelopeError("Cannot serialize an event into a bundle");
+    }
+}
+
+void TickBundler::append(const Event& event, RakNet::RakNetGUID destination)
+{
+    DeliveryPolicy policy = EnvelopeMessage::deliveryPolicy(event.i_category, event.i_id);
+
+    // Events only share a bundle with events sent the same way
+    std::vector<EnvelopeBundle>& queued = bundles[destination];
+    auto open = std::find_if(queued.rbegin(), queued.rend(),
+        [&policy](const EnvelopeBundle& bundle) { return bundle.policy == policy; });
+    if (open == queued.rend() || (open->count > 0 && EnvelopeBundle::bytesWith(
+        open->entries->GetNumberOfBitsUsed(), payload.GetNumberOfBitsUsed()) > MaxBundleBytes))
+    {
+        queued.emplace_back();
+        queued.back().policy = policy;
+        queued.back().append(event.i_category, event.i_id, payload);
+        return;
+    }
+    open->append(event.i_category, event.i_id, payload);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "RakNetTypes.h" // For RakNetGUID
+
+#include "BitStream.h"
+
+#include "EventSystem.h"
+#include "Messages.h"
+
+/*!
+ * Gathers the events sent to each node during a tick, so they can be sent as a few
+ * EnvelopeBundle packets per node instead of one packet per event.
+ *
+ * Each event is serialized once, however many nodes it goes to. Events are only bundled
+ * with others that have the same EnvelopeMessage::deliveryPolicy, so that, say, a status
+ * update is not sent unreliably with the snapshots around it. Bundles are kept under
+ * MaxBundleBytes, so they fit in a single datagram; an event too large for that is sent
+ * in a bundle of its own, which RakNet splits as usual.
+ *
+ * Not thread-safe: the game master only uses it under its state lock.
+ */
+class TickBundler
+{
+public:
+    /// Largest bundle, in bytes, that more events are added to. Leaves room for RakNet/UDP/IP headers in a 1500 byte MTU
+    constexpr static size_t MaxBundleBytes = 1200;
+
+    /// Bundles are sent through the given EventSystem's network
+    TickBundler(EventSystem* eventSystem_);
+
+    /// Adds an event to the bundles of one node
+    void add(const Event& event, RakNet::RakNetGUID destination);
+
+    /// Adds an event to the bundles of several nodes
+    void add(const Event& event, const std::set<RakNet::RakNetGUID>& destinations);
+
+    /**
+     * Sends every gathered bundle, and starts over. Events with the same delivery policy
+     * keep the order they were added in; events with different policies go in different
+     * bundles (and RakNet channels), so are not ordered against each other.
+     *
+     * Bundles for a node that is no longer connected are dropped, with a warning.
+     */
+    void flush();
+
+    /// Returns the bundles gathered for a node so far, for inspection
+    const std::vector<EnvelopeBundle>& pending(RakNet::RakNetGUID destination);
+
+private:
+    /// Serializes an event into payload, throwing if it is not networked
+    void serialize(const Event& event);
+
+    /// Appends the serialized payload to a node's last bundle with its policy, or to a new one if it would not fit
+    void append(const Event& event, RakNet::RakNetGUID destination);
+
+    EventSystem* eventSystem;
+
+    /// Serialized event being added, reused between events
+    RakNet::BitStream payload;
+
+    /// Bundles waiting to go to each node
+    std::map<RakNet::RakNetGUID, std::vector<EnvelopeBundle>> bundles;
+};
@@ -0,0 +1,131 @@
+#include "UnitStateDelta.h"
+
+#include "EventCodec.h"
+#include "Log.h"
+
+#include <algorithm>
+
+/// Key for the states of one unit
+static uint64_t unitKey(uint32_t team, uint32_t unit)
+{
+    return ((uint64_t)team << 32) | unit;
+}
+
+EnvelopeMessage UnitStateBaselines::makeEnvelope(const UnitState& state, RakNet::RakNetGUID client)
+{
+    UnitStateDelta delta;
+    delta.team = state.team;
+    delta.unit = state.unit;
+
+    std::lock_guard<std::mutex> lock(mux);
+    History& history = histories[std::make_pair(client, unitKey(state.team, state.unit))];
+    delta.sequence = history.nextSequence++;
+
+    if (history.baseline != 0 && delta.sequence - history.baseline < DeltaHistory)
+    {
+        delta.baseline = history.baseline;
+        delta.mask = deltaMask(state, history.sent[history.baseline % DeltaHistory]);
+    } else {
+        uint32_t count = fieldCount(state);
+        delta.baseline = 0;
+        delta.mask = count == 64 ? ~0ull : (1ull << count) - 1;
+    }
+
+    // Unchanged fields (usually including both tube vectors) are never copied
+    copyFields(delta.state, state, delta.mask);
+    history.sent[delta.sequence % DeltaHistory] = state;
+
+    return EnvelopeMessage(std::move(delta), client);
+}
+
+void UnitStateBaselines::acknowledge(const UnitStateAck& ack)
+{
+    std::lock_guard<std::mutex> lock(mux);
+    auto it = histories.find(std::make_pair(ack.sender, unitKey(ack.team, ack.unit)));
+    if (it == histories.end())
+    {
+        return;
+    }
+    History& history = it->second;
+
+    if (ack.sequence == 0)
+    {
+        Log::writeToLog(Log::L_DEBUG, "Client ", RakNet::RakNetGUID::ToUint32(ack.sender), " asked for a full state of unit (", ack.team, ",",
+            ack.unit, ")");
+        history.baseline = 0;
+        history.resyncSequence = history.nextSequence;
+        return;
+    }
+
+    // Ignore acks that are stale, or for states that have already left the history
+    if (ack.sequence < history.resyncSequence || ack.sequence <= history.baseline
+        || ack.sequence >= history.nextSequence || history.nextSequence - ack.sequence > DeltaHistory)
+    {
+        return;
+    }
+    history.baseline = ack.sequence;
+}
+
+void UnitStateBaselines::forget(RakNet::RakNetGUID client)
+{
+    std::lock_guard<std::mutex> lock(mux);
+    histories.erase(histories.lower_bound(std::make_pair(client, (uint64_t)0)),
+        histories.upper_bound(std::make_pair(client, ~(uint64_t)0)));
+}
+
+UnitStateDeltaReceiver::UnitStateDeltaReceiver(EventSystem* eventSystem_)
+    : EventReceiver(eventSystem_, {
+        dispatchEvent<UnitStateDeltaReceiver, UnitStateDelta, &UnitStateDeltaReceiver::handleDelta>()})
+{}
+
+HandleResult UnitStateDeltaReceiver::handleDelta(UnitStateDelta* event)
+{
+    UnitStateAck ack;
+    ack.team = event->team;
+    ack.unit = event->unit;
+    ack.sequence = event->sequence;
+
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        History& history = histories[unitKey(event->team, event->unit)];
+        UnitState& state = history.states[event->sequence % DeltaHistory];
+
+        if (event->baseline == 0)
+        {
+            std::fill(history.sequences, history.sequences + DeltaHistory, 0);
+            state = event->state;
+        } else {
+            uint32_t slot = event->baseline % DeltaHistory;
+            if (history.sequences[slot] != event->baseline)
+            {
+                Log::writeToLog(Log::L_DEBUG, "Missing baseline ", event->baseline, " for unit (", event->team, ",",
+                    event->unit, "); asking for a full state");
+                ack.sequence = 0;
+            } else {
+                state = history.states[slot];
+                copyFields(state, event->state, event->mask);
+            }
+        }
+
+        if (ack.sequence != 0)
+        {
+            history.sequences[event->sequence % DeltaHistory] = event->sequence;
+            eventSystem->queueEvent(state);
+        }
+    }
+
+    sendAck(std::move(ack));
+    return HandleResult::Stop;
+}
+
+void UnitStateDeltaReceiver::reset()
+{
+    std::lock_guard<std::mutex> lock(mux);
+    histories.clear();
+}
+
+void UnitStateDeltaReceiver::sendAck(UnitStateAck&& ack)
+{
+    // Unaddressed envelopes go to the game master
+    eventSystem->queueEvent(EnvelopeMessage(std::move(ack)));
+}
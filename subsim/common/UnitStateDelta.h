@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "RakNetTypes.h" // For RakNetGUID
+
+#include "EventSystem.h"
+#include "Messages.h"
+#include "SimulationEvents.h"
+
+/*!
+ * Delta encoding of UnitState.
+ *
+ * The game master sends each client a UnitStateDelta holding only the fields that changed
+ * since the newest state that client acknowledged (its baseline). Clients rebuild the full
+ * UnitState, queue it as usual and acknowledge it with a UnitStateAck.
+ *
+ * Both ends remember the last DeltaHistory states. If the baseline falls that far behind
+ * (acks are being lost) the game master sends a full state instead. If a client cannot find
+ * the baseline of a delta (after reconnecting, say) it asks for a full state with a 0 ack.
+ */
+constexpr static uint32_t DeltaHistory = 32;
+
+/*!
+ * Game master side: remembers what was sent to every client, and which of it was acknowledged.
+ * Thread-safe.
+ */
+class UnitStateBaselines
+{
+public:
+    /// Builds the envelope that sends the given state to a client, as a delta where possible
+    EnvelopeMessage makeEnvelope(const UnitState& state, RakNet::RakNetGUID client);
+
+    /// Moves the client's baseline up to the acknowledged state, or drops it on a 0 ack
+    void acknowledge(const UnitStateAck& ack);
+
+    /// Forgets everything sent to a client, such as when it disconnects
+    void forget(RakNet::RakNetGUID client);
+
+private:
+    /// States sent to one client for one unit
+    struct History
+    {
+        History() : nextSequence(1), baseline(0), resyncSequence(0) {}
+
+        uint32_t nextSequence;
+
+        /// Newest acknowledged sequence number, or 0 if the client has no usable baseline
+        uint32_t baseline;
+
+        /// Acks older than this were sent before a resync, and are ignored
+        uint32_t resyncSequence;
+
+        /// Recently sent states, indexed by sequence % DeltaHistory
+        UnitState sent[DeltaHistory];
+    };
+
+    /// Keyed by client, then (team << 32 | unit)
+    std::map<std::pair<RakNet::RakNetGUID, uint64_t>, History> histories;
+
+    std::mutex mux;
+};
+
+/*!
+ * Client side: rebuilds full UnitStates from the deltas the game master sends, queueing them
+ * in this receiver's EventSystem and acknowledging them.
+ */
+class UnitStateDeltaReceiver : public EventReceiver
+{
+public:
+    UnitStateDeltaReceiver(EventSystem* eventSystem_ = nullptr);
+    virtual ~UnitStateDeltaReceiver() {}
+
+    /// Applies a delta to its baseline
+    HandleResult handleDelta(UnitStateDelta* event);
+
+    /// Forgets every received state, such as when the connection is lost
+    void reset();
+
+protected:
+    /// Sends an acknowledgement to the game master
+    virtual void sendAck(UnitStateAck&& ack);
+
+private:
+    /// States received for one unit, indexed by sequence % DeltaHistory
+    struct History
+    {
+        History() : sequences() {}
+
+        uint32_t sequences[DeltaHistory];
+        UnitState states[DeltaHistory];
+    };
+
+    /// Keyed by (team << 32 | unit)
+    std::map<uint64_t, History> histories;
+
+    std::mutex mux;
+};
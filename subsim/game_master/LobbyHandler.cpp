@@ -6,7 +6,8 @@
 
 #include "../common/SimulationEvents.h"
 
-LobbyHandler::LobbyHandler(const ParseResult& parse)
+LobbyHandler::LobbyHandler(const ParseResult& parse, EventSystem* eventSystem_)
+    : eventSystem(eventSystem_)
 {
     std::vector<std::pair<uint16_t, StationType>> requestedStations;
     std::map<uint16_t, Team_t> parsedStations = TeamParser::parseStations(parse);
@@ -203,15 +204,15 @@ bool LobbyHandler::LobbyStatusRequested(RakNet::RakNetGUID other, const LobbySta
             sstart.stations = pair.second;
             sstart.teamNames = names;
 
-            EnvelopeMessage envelope(sstart, pair.first);
+            EnvelopeMessage envelope(std::move(sstart), pair.first);
             // deliver simstart's to all attached clients!
-            EventSystem::getGlobalInstance()->queueEvent(envelope);
+            eventSystem->queueEvent(envelope);
         }
 
         // Now, send a SimStart command to ourselves
         SimulationStartServer serverStart;
-        serverStart.assignments = serverAssignments;
-        EventSystem::getGlobalInstance()->queueEvent(serverStart);
+        serverStart.assignments = std::move(serverAssignments);
+        eventSystem->queueEvent(std::move(serverStart));
     }
             
 
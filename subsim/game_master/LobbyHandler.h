@@ -13,8 +13,8 @@
 class LobbyHandler : public ReceiveInterface
 {
 public:
-    /// Sets up the initial lobby status, by opening a given parsed config file
-    LobbyHandler(const ParseResult& parse);
+    /// Sets up the initial lobby status, by opening a given parsed config file. Game start events go to the given EventSystem.
+    LobbyHandler(const ParseResult& parse, EventSystem* eventSystem_);
     /// Catch disconnect events so we can remove them from the lobby
     virtual bool ConnectionLost(RakNet::RakNetGUID other) override;
     /// Catch lobby request events so we can identify people who want to join the lobby
@@ -32,4 +32,7 @@ private:
      * Stores the current LobbyStatus
      */
     LobbyStatus status;
+
+    /// EventSystem that this lobby's SimulationStart events are sent through
+    EventSystem* eventSystem;
 };
@@ -10,36 +10,35 @@
 #include "../common/Log.h"
 #include "../common/Exceptions.h"
 
-std::random_device rd;
-std::mt19937 gen;
-
 inline bool didCollide(int64_t x1, int64_t y1, int64_t x2, int64_t y2, int32_t radius)
 {
     return (x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1) < radius * radius;
 }
 
-SimulationMaster::SimulationMaster(Network* network_, const std::string& filename)
+SimulationMaster::SimulationMaster(Network* network_, const std::string& filename, EventSystem* events)
     : shouldShutdown(false)
     , network(network_)
-    , EventReceiver({
-        dispatchEvent<SimulationMaster, SimulationStartServer, &SimulationMaster::simStart>,
-        dispatchEvent<SimulationMaster, ThrottleEvent, &SimulationMaster::throttle>,
-        dispatchEvent<SimulationMaster, SteeringEvent, &SimulationMaster::steering>,
-        dispatchEvent<SimulationMaster, FireEvent, &SimulationMaster::fire>,
-        dispatchEvent<SimulationMaster, TubeLoadEvent, &SimulationMaster::tubeLoad>,
-        dispatchEvent<SimulationMaster, TubeArmEvent, &SimulationMaster::tubeArm>,
-        dispatchEvent<SimulationMaster, PowerEvent, &SimulationMaster::power>,
-        dispatchEvent<SimulationMaster, StealthEvent, &SimulationMaster::stealth>,
-    })
+    , EventReceiver(events, {
+        dispatchEvent<SimulationMaster, SimulationStartServer, &SimulationMaster::simStart>(),
+        dispatchBatch<SimulationMaster, ThrottleEvent, &SimulationMaster::throttle>(),
+        dispatchBatch<SimulationMaster, SteeringEvent, &SimulationMaster::steering>(),
+        dispatchEvent<SimulationMaster, FireEvent, &SimulationMaster::fire>(),
+        dispatchEvent<SimulationMaster, TubeLoadEvent, &SimulationMaster::tubeLoad>(),
+        dispatchEvent<SimulationMaster, TubeArmEvent, &SimulationMaster::tubeArm>(),
+        dispatchEvent<SimulationMaster, PowerEvent, &SimulationMaster::power>(),
+        dispatchEvent<SimulationMaster, StealthEvent, &SimulationMaster::stealth>(),
+        dispatchBatch<SimulationMaster, UnitStateAck, &SimulationMaster::unitStateAck>(),
+        dispatchEvent<SimulationMaster, TerrainRequest, &SimulationMaster::terrainRequest>(),
+    }, DeliveryMode::Mailbox) // Handlers wait on stateMux during a tick
+    , bundler(eventSystem)
+    , gen(rd())
 {
     ParseResult result = GenericParser::parse(filename);
     config = ConfigParser::parseConfig(result);
+    configTerrainHash = terrainHash(config.terrain);
     overrideScores = TeamParser::parseScoring(result);
 
-    gen = std::mt19937(rd());
-
-    
-    lobbyInit = std::unique_ptr<LobbyHandler>(new LobbyHandler(result));
+    lobbyInit = std::unique_ptr<LobbyHandler>(new LobbyHandler(result, eventSystem));
     network->registerCallback(lobbyInit.get());
 
 }
@@ -51,6 +50,7 @@ SimulationMaster::~SimulationMaster()
     if (simLoop.joinable())
     {
         simLoop.join();
+        network->deregisterCallback(this);
     }
     Log::writeToLog(Log::INFO, "Simulation thread shutdown successfully.");
 }
@@ -115,14 +115,24 @@ void SimulationMaster::runSimLoop()
 {
     Log::writeToLog(Log::INFO, "Main simulation loop started!");
 
+    // Reused across ticks so that their containers keep their capacity
+    SonarDisplayState sonar;
+    ScoreEvent score;
+
     while (!shouldShutdown)
     {
         //TODO: possibly replace with a sleep until to keep game logic on a schedule?
         std::this_thread::sleep_for(std::chrono::milliseconds(config.frameMilliseconds));
 
         std::lock_guard<std::mutex> lock(stateMux);
+        dropLostClients();
 
-        SonarDisplayState sonar;
+        sonar.units.clear();
+        sonar.torpedos.clear();
+        sonar.mines.clear();
+        sonar.flags.clear();
+        sonar.mapWidth = config.terrain.width * config.terrain.scale;
+        sonar.mapHeight = config.terrain.height * config.terrain.scale;
 
         // Remove any torpedos that intersect a wall
         auto it = torpedos.begin();
@@ -176,14 +186,17 @@ void SimulationMaster::runSimLoop()
             for (UnitState &unitState : teamPair.second)
             {
                 runSimForUnit(&unitState);
-                // Deliver latest UnitState to every attached client
-                // This will send a redundant message if the same client is
-                // handling multiple stations for a single unit, but it doesn't
-                // matter
+                // Deliver latest UnitState to every attached client, once even if it handles several
+                // stations of this unit. Each gets the fields that changed since the last state it acknowledged
+                std::set<RakNet::RakNetGUID> unitClients;
                 for (const auto &stationPair : assignments[unitState.team][unitState.unit])
                 {
-                    EnvelopeMessage envelope(unitState, stationPair.second);
-                    EventSystem::getGlobalInstance()->queueEvent(envelope);
+                    unitClients.insert(stationPair.second);
+                }
+                for (const RakNet::RakNetGUID& client : unitClients)
+                {
+                    EnvelopeMessage delta = baselines.makeEnvelope(unitState, client);
+                    bundler.add(*delta.event, delta.address);
                 }
 
                 // Skip sonar state if this unit is correctly in stealth mode without the flag
@@ -198,7 +211,6 @@ void SimulationMaster::runSimLoop()
                 unitSonarState.unit = unitState.unit;
                 unitSonarState.x = unitState.x;
                 unitSonarState.y = unitState.y;
-                unitSonarState.depth = unitState.depth;
                 unitSonarState.heading = unitState.heading;
                 unitSonarState.speed = unitState.speed;
                 unitSonarState.power = unitState.powerAvailable;
@@ -212,17 +224,38 @@ void SimulationMaster::runSimLoop()
             }
         }
 
-        ScoreEvent score;
         score.scores = scores;
-        // Deliver latest SonarDisplayState and ScoreEvent to every attached client
-        for (const RakNet::RakNetGUID &client : all_clients)
-        {
-            EnvelopeMessage envelope(sonar, client);
-            EventSystem::getGlobalInstance()->queueEvent(envelope);
+        // Deliver latest SonarDisplayState and ScoreEvent to every attached client, serialized once for all clients
+        bundler.add(sonar, all_clients);
+        bundler.add(score, all_clients);
+
+        // Everything sent this tick goes out as one bundle per client (more only if it overflows a datagram)
+        bundler.flush();
+    }
+}
+
+void SimulationMaster::dropLostClients()
+{
+    std::set<RakNet::RakNetGUID> lost;
+    {
+        std::lock_guard<std::mutex> lock(lostMux);
+        lost.swap(lostClients);
+    }
 
-            EnvelopeMessage scoreEnvelope(score, client);
-            EventSystem::getGlobalInstance()->queueEvent(scoreEnvelope);
+    for (const RakNet::RakNetGUID& client : lost)
+    {
+        Log::writeToLog(Log::INFO, "Client ", client, " disconnected; no longer sending it the simulation.");
+        all_clients.erase(client);
+        for (auto& teamPair : assignments)
+        {
+            for (auto& unitStations : teamPair.second)
+            {
+                unitStations.erase(std::remove_if(unitStations.begin(), unitStations.end(),
+                    [&client](const std::pair<StationType, RakNet::RakNetGUID>& station) { return station.second == client; }),
+                    unitStations.end());
+            }
         }
+        baselines.forget(client);
     }
 }
 
@@ -376,10 +409,7 @@ void SimulationMaster::runSimForUnit(UnitState *unitState)
                 statusEvent.team = unitState->team;
                 statusEvent.unit = unitState->unit;
                 statusEvent.type = StatusUpdateEvent::FlagTaken;
-                for (auto& client : all_clients)
-                {
-                    EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(statusEvent, client));
-                }
+                bundler.add(statusEvent, all_clients);
             }
         }
     }
@@ -412,10 +442,7 @@ void SimulationMaster::runSimForUnit(UnitState *unitState)
             statusEvent.team = unitState->team;
             statusEvent.unit = unitState->unit;
             statusEvent.type = StatusUpdateEvent::FlagScored;
-            for (auto& client : all_clients)
-            {
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(statusEvent, client));
-            }
+            bundler.add(statusEvent, all_clients);
         }
     }
 
@@ -477,20 +504,14 @@ void SimulationMaster::damage(uint32_t team, uint32_t unit, int16_t amount)
             statusEvent.team = u->team;
             statusEvent.unit = u->unit;
             statusEvent.type = StatusUpdateEvent::FlagSubKill;
-            for (auto& client : all_clients)
-            {
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(statusEvent, client));
-            }
+            bundler.add(statusEvent, all_clients);
         } else {
             // Generate StatusUpdate events for normal sub kill
             StatusUpdateEvent statusEvent;
             statusEvent.team = u->team;
             statusEvent.unit = u->unit;
             statusEvent.type = StatusUpdateEvent::SubKill;
-            for (auto& client : all_clients)
-            {
-                EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(statusEvent, client));
-            }
+            bundler.add(statusEvent, all_clients);
         }
     }
 }
@@ -501,11 +522,7 @@ void SimulationMaster::explosion(int64_t x, int64_t y, int16_t size)
     exp.x = x;
     exp.y = y;
     exp.size = size;
-    for (const RakNet::RakNetGUID &client : all_clients)
-    {
-        EnvelopeMessage envelope(exp, client);
-        EventSystem::getGlobalInstance()->queueEvent(envelope);
-    }
+    bundler.add(exp, all_clients);
 }
 
 HandleResult SimulationMaster::simStart(SimulationStartServer* event)
@@ -560,7 +577,6 @@ HandleResult SimulationMaster::simStart(SimulationStartServer* event)
             flag.team = teamFlags.first;
             flag.x = flagLocation.first;
             flag.y = flagLocation.second;
-            flag.depth = 0;
             flag.isTaken = false;
 
             flags[nextFlagID++] = flag;
@@ -574,7 +590,6 @@ HandleResult SimulationMaster::simStart(SimulationStartServer* event)
         MineState mineS;
         mineS.x = mine.first;
         mineS.y = mine.second;
-        mineS.depth = 0;
 
         mines[nextMineID++] = mineS;
     }
@@ -583,19 +598,22 @@ HandleResult SimulationMaster::simStart(SimulationStartServer* event)
     // Unhook the lobby handler and destroy it
     network->deregisterCallback(lobbyInit.get());
     lobbyInit.reset();
+    network->registerCallback(this);
 
     // Send config data and GameStart status update to all connected clients
+    // The terrain goes by hash; clients that have not cached it ask for it with a TerrainRequest
     ConfigEvent configEvent;
     configEvent.config = config;
+    configEvent.config.terrain.map.clear();
+    configEvent.terrainHash = configTerrainHash;
     StatusUpdateEvent statusEvent;
     statusEvent.team = statusEvent.unit = 0;
     statusEvent.type = StatusUpdateEvent::Type::GameStart;
 
-    for (auto& client : all_clients)
-    {
-        EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(configEvent, client));
-        EventSystem::getGlobalInstance()->queueEvent(EnvelopeMessage(statusEvent, client));
-    }
+    EnvelopeMessage configEnvelope(std::move(configEvent));
+    EnvelopeMessage statusEnvelope(std::move(statusEvent));
+    eventSystem->queueBroadcast(configEnvelope, all_clients);
+    eventSystem->queueBroadcast(statusEnvelope, all_clients);
 
     // Start the game loop
     Log::writeToLog(Log::L_DEBUG, "Simulation master attempting to start simulation thread...");
@@ -605,41 +623,82 @@ HandleResult SimulationMaster::simStart(SimulationStartServer* event)
 }
 
 /// Handles the event when a submarine changes its throttle
-HandleResult SimulationMaster::throttle(ThrottleEvent *event)
+HandleResult SimulationMaster::throttle(const EventBatch<ThrottleEvent>& events)
 {
     {
         std::lock_guard<std::mutex> lock(stateMux);
-        // stop if unit is respawning
-        if (unitStates[event->team][event->unit].respawning)
+        for (ThrottleEvent* event : events)
         {
-            return HandleResult::Stop;
+            // skip if unit is respawning
+            if (unitStates[event->team][event->unit].respawning)
+            {
+                continue;
+            }
+
+            unitStates[event->team][event->unit].desiredSpeed =
+                std::min(event->desiredSpeed, config.subMaxSpeed);
         }
-        
-        unitStates[event->team][event->unit].desiredSpeed =
-            std::min(event->desiredSpeed, config.subMaxSpeed);
     }
 
     return HandleResult::Stop;
 }
 
 
-HandleResult SimulationMaster::steering(SteeringEvent *event)
+HandleResult SimulationMaster::unitStateAck(const EventBatch<UnitStateAck>& events)
+{
+    // Baselines have their own lock, so acks never wait on a tick
+    for (UnitStateAck* event : events)
+    {
+        baselines.acknowledge(*event);
+    }
+    return HandleResult::Stop;
+}
+
+HandleResult SimulationMaster::terrainRequest(TerrainRequest* event)
+{
+    // The config does not change once loaded, so this does not need stateMux
+    if (event->hash != configTerrainHash)
+    {
+        Log::writeToLog(Log::WARN, "Client ", RakNet::RakNetGUID::ToUint32(event->sender),
+            " asked for unknown terrain; ignoring");
+        return HandleResult::Stop;
+    }
+
+    Log::writeToLog(Log::L_DEBUG, "Sending terrain to client ", RakNet::RakNetGUID::ToUint32(event->sender));
+    TerrainData data;
+    data.hash = configTerrainHash;
+    data.terrain = config.terrain;
+    eventSystem->queueEvent(EnvelopeMessage(std::move(data), event->sender));
+    return HandleResult::Stop;
+}
+
+bool SimulationMaster::ConnectionLost(RakNet::RakNetGUID other)
+{
+    std::lock_guard<std::mutex> lock(lostMux);
+    lostClients.insert(other);
+    return true;
+}
+
+HandleResult SimulationMaster::steering(const EventBatch<SteeringEvent>& events)
 {
     {
         std::lock_guard<std::mutex> lock(stateMux);
-        // stop if unit is respawning
-        if (unitStates[event->team][event->unit].respawning)
-        {
-            return HandleResult::Stop;
-        }
-        
-        if (event->isPressed == false)
+        for (SteeringEvent* event : events)
         {
-            unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Center;
-        } else if (event->direction == SteeringEvent::Direction::Left) {
-            unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Left;
-        } else if (event->direction == SteeringEvent::Direction::Right) {
-            unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Right;
+            // skip if unit is respawning
+            if (unitStates[event->team][event->unit].respawning)
+            {
+                continue;
+            }
+
+            if (event->isPressed == false)
+            {
+                unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Center;
+            } else if (event->direction == SteeringEvent::Direction::Left) {
+                unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Left;
+            } else if (event->direction == SteeringEvent::Direction::Right) {
+                unitStates[event->team][event->unit].direction = UnitState::SteeringDirection::Right;
+            }
         }
     }
     return HandleResult::Stop;
@@ -722,7 +781,6 @@ HandleResult SimulationMaster::fire(FireEvent *event)
                 TorpedoState torp;
                 torp.x = unit.x + 1.5 * config.collisionRadius * cos(newHeading * 2*M_PI/360.0);
                 torp.y = unit.y + 1.5 * config.collisionRadius * sin(newHeading * 2*M_PI/360.0);
-                torp.depth = unit.depth;
                 torp.heading = newHeading;
                 torpedos[nextTorpedoID++] = torp;
 
@@ -746,7 +804,6 @@ HandleResult SimulationMaster::fire(FireEvent *event)
                 mine.y = unit.y
                     - 1.5 * config.collisionRadius * v
                     - 2.0 * (minSpreadPos + i) * config.collisionRadius * u;
-                mine.depth = unit.depth;
 
                 /// Calculate if the mine falls within an exclusion zone
                 bool isExcluded = false;
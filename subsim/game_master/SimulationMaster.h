@@ -1,11 +1,15 @@
 #pragma once
 #include "../common/Network.h"
 #include "../common/SimulationEvents.h"
+#include "../common/UnitStateDelta.h"
 #include "LobbyHandler.h"
 
 #include "../common/ConfigParser.h"
+#include "../common/TerrainCache.h"
+#include "../common/TickBundler.h"
 
 #include <memory>
+#include <random>
 #include <thread>
 
 /*!
@@ -13,11 +17,15 @@
  * an instance of a LobbyHandler to get clients, but once it acquries enough clients
  * to start the game, it switches over to simulation mode.
  */
-class SimulationMaster : public EventReceiver
+class SimulationMaster : public EventReceiver, public ReceiveInterface
 {
 public:
-    /// Takes an initalized Network instance, in order to communicate with clients, plus a filename
-    SimulationMaster(Network* network, const std::string& filename);
+    /**
+     * Takes an initalized Network instance, in order to communicate with clients, plus a filename.
+     * Events are received from and sent through the given EventSystem, or the global one if nullptr,
+     * so several matches can be hosted by one process.
+     */
+    SimulationMaster(Network* network, const std::string& filename, EventSystem* events = nullptr);
 
     /// Stops the game loop upon destruction
     ~SimulationMaster();
@@ -25,11 +33,11 @@ public:
     /// Handles the event spawned when the lobby is full, and the game is starting
     HandleResult simStart(SimulationStartServer* event);
     
-    /// Handles the event when a submarine changes its throttle
-    HandleResult throttle(ThrottleEvent *event);
+    /// Handles every throttle change that arrived since the last batch
+    HandleResult throttle(const EventBatch<ThrottleEvent>& events);
 
-    /// Handles the event when the submarine steers left or right
-    HandleResult steering(SteeringEvent *event);
+    /// Handles every left/right steering change that arrived since the last batch
+    HandleResult steering(const EventBatch<SteeringEvent>& events);
 
     /// Handles the event when the submarine fires its armed torpedos/mines
     HandleResult fire(FireEvent *event);
@@ -46,6 +54,15 @@ public:
     /// Handles when clients use stealth
     HandleResult stealth(StealthEvent* event);
 
+    /// Handles every UnitState acknowledgement that arrived since the last batch
+    HandleResult unitStateAck(const EventBatch<UnitStateAck>& events);
+
+    /// Sends the terrain to a client that did not have it cached
+    HandleResult terrainRequest(TerrainRequest* event);
+
+    /// Notes a client that disconnected during the simulation, so the next tick stops sending to it
+    virtual bool ConnectionLost(RakNet::RakNetGUID other) override;
+
 private:
     /// Calculates initial state for a submarine, when first spawning or when
     /// respawning
@@ -57,6 +74,9 @@ private:
     /// Helper function for runSimLoop
     void runSimForUnit(UnitState *unitState);
 
+    /// Stops sending to clients that disconnected, and forgets their baselines. Called under stateMux
+    void dropLostClients();
+
     /// Applies damage to a submarine, handling destruction if necessary
     void damage(uint32_t team, uint32_t unit, int16_t amount);
 
@@ -85,6 +105,16 @@ private:
     /// Internal unit states
     std::map<uint32_t, std::vector<UnitState>> unitStates;
 
+    /// What each client has acknowledged, so unit states can be sent as deltas
+    UnitStateBaselines baselines;
+
+    /// Clients that disconnected since the last tick. Has its own mutex, so the receive thread never waits on a tick
+    std::set<RakNet::RakNetGUID> lostClients;
+    std::mutex lostMux;
+
+    /// Gathers everything sent during a tick into one packet per client. Used under stateMux
+    TickBundler bundler;
+
     /// Stores the next unused ID number for torpedos/mines
     TorpedoID nextTorpedoID;
     MineID nextMineID;
@@ -107,5 +137,12 @@ private:
 
     /// Stores the game configuration
     Config config;
+
+    /// terrainHash() of config.terrain, which clients fetch by hash
+    uint64_t configTerrainHash;
+
+    /// Random source for spawn positions. Kept per match, so matches in one process do not race on it
+    std::random_device rd;
+    std::mt19937 gen;
 };
 
@@ -1,9 +1,11 @@
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
 
 #include "version.h"
 #include "../common/EventSystem.h"
+#include "../common/EventJournal.h"
 #include "../common/Network.h"
 #include "../common/Log.h"
 
@@ -12,7 +14,7 @@
 void print_usage(char* prog_name)
 {
     Log::writeToLog(Log::FATAL, "Invalid command line arguments");
-    std::cerr << prog_name << " -f [config_file]\n";
+    std::cerr << prog_name << " -f [config_file] (-j [journal_file])\n";
 }
 
 int main(int argc, char **argv)
@@ -24,7 +26,8 @@ int main(int argc, char **argv)
 
     Log::writeToLog(Log::INFO, "Subsim game master version v", VERSION_MAJOR, ".", VERSION_MINOR, " started");
 
-    if (argc != 3 || std::string(argv[1]) != std::string("-f"))
+    if ((argc != 3 && argc != 5) || std::string(argv[1]) != std::string("-f")
+        || (argc == 5 && std::string(argv[3]) != std::string("-j")))
     {
         print_usage(argv[0]);
         return 1;
@@ -34,6 +37,13 @@ int main(int argc, char **argv)
     Network network(true);
     EventSystem events(&network);
 
+    // Optionally record all match traffic, for replaying later with EventJournal::replay
+    std::unique_ptr<EventJournal> journal;
+    if (argc == 5)
+    {
+        journal.reset(new EventJournal(&events, argv[4]));
+    }
+
     SimulationMaster master(&network, argv[2]);
 
     std::cout << "Press enter to exit...\n";
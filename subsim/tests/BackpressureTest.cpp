@@ -0,0 +1,215 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+#include "../common/Network.h"
+#include "../common/SimulationEvents.h"
+
+#include "BitStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Checks the send queue's backpressure: a game master sends a station sonar snapshots
+ * (SonarDisplayStates) far faster than its link, limited to 1 Mbit/s, can carry, with a
+ * StatusUpdateEvent every so often.
+ *
+ * Sending must not wait on the link, so takes far less time than the link needs to carry
+ * what is sent, and the station's queue must stay around
+ * Network::MaxQueuedBytes, with old snapshots dropped instead of buffered. Status updates
+ * are reliable, so every one must still arrive, in order.
+ */
+
+const uint32_t numSnapshots = 500;
+const uint32_t statusEvery = 50;
+const unsigned linkBitsPerSecond = 1000 * 1000;
+
+std::atomic<bool> connected(false);
+std::atomic<uint64_t> stationGUID(0);
+std::atomic<uint32_t> snapshotsReceived(0);
+std::mutex receivedMux;
+std::vector<uint32_t> statuses;
+
+class ConnectionWatcher : public ReceiveInterface
+{
+public:
+    bool ConnectionEstablished(RakNet::RakNetGUID other) override
+    {
+        stationGUID = other.g;
+        connected = true;
+        return true;
+    }
+};
+
+class Station : public EventReceiver
+{
+public:
+    Station(EventSystem* system)
+        : EventReceiver(system, {
+            dispatchEvent<Station, SonarDisplayState, &Station::handleSonar>(),
+            dispatchEvent<Station, StatusUpdateEvent, &Station::handleStatus>()})
+    {}
+
+    HandleResult handleSonar(SonarDisplayState* event)
+    {
+        ++snapshotsReceived;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleStatus(StatusUpdateEvent* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        statuses.push_back(event->unit);
+        return HandleResult::Stop;
+    }
+};
+
+/// A busy sonar picture: six subs and 200 torpedos, around 1.6 kB on the wire
+SonarDisplayState makeSonar()
+{
+    SonarDisplayState sonar;
+    sonar.mapWidth = sonar.mapHeight = 50000;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        UnitSonarState unit;
+        unit.team = i % 2;
+        unit.unit = i / 2;
+        unit.x = 5000 + i * 7000;
+        unit.y = 45000 - i * 7000;
+        unit.heading = i * 60;
+        unit.speed = 20;
+        unit.power = 100;
+        unit.hasFlag = unit.isStealth = unit.respawning = false;
+        unit.stealthCooldown = unit.respawnCooldown = 0;
+        sonar.units.push_back(unit);
+    }
+    for (uint32_t i = 0; i < 200; ++i)
+    {
+        sonar.torpedos.push_back(TorpedoState{(i * 7919) % 50000, (i * 104729) % 50000, (uint16_t)(i % 360)});
+    }
+    return sonar;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::WARN);
+
+    // Not the usual port, so a running game master does not get in the way
+    const unsigned short port = NETWORK_SERVER_PORT + 3;
+
+    Network serverNetwork(true, port);
+    EventSystem server(&serverNetwork, false);
+    ConnectionWatcher watcher;
+    serverNetwork.registerCallback(&watcher);
+
+    Network clientNetwork(false);
+    EventSystem client(&clientNetwork, false);
+    Station station(&client);
+    clientNetwork.connect("127.0.0.1", port);
+
+    for (uint32_t i = 0; i < 500 && !connected; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!connected)
+    {
+        std::cout << "TEST FAILURE: Client could not connect over loopback\n";
+        return 1;
+    }
+
+    RakNet::RakNetGUID destination;
+    destination.g = stationGUID;
+    serverNetwork.limitOutgoingBandwidth(linkBitsPerSecond);
+
+    SonarDisplayState sonar = makeSonar();
+    StatusUpdateEvent status;
+    status.team = 0;
+    status.type = StatusUpdateEvent::FlagTaken;
+
+    // What the link would take to carry every snapshot, were sending to wait on it
+    RakNet::BitStream serialized;
+    EnvelopeMessage::serializeEvent(sonar, serialized);
+    double linkMs = 1000.0 * numSnapshots * serialized.GetNumberOfBytesUsed() * 8 / linkBitsPerSecond;
+
+    double totalSend = 0;
+    double slowestSend = 0;
+    size_t mostQueued = 0;
+    for (uint32_t i = 0; i < numSnapshots; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        server.queueBroadcast(EnvelopeMessage(sonar), {destination});
+        if (i % statusEvery == 0)
+        {
+            status.unit = i / statusEvery;
+            server.queueBroadcast(EnvelopeMessage(status), {destination});
+        }
+        double sendMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        totalSend += sendMs;
+        slowestSend = std::max(slowestSend, sendMs);
+
+        mostQueued = std::max(mostQueued, serverNetwork.queuedBytes(destination));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The link drains what is queued and buffered in well under a second
+    const uint32_t numStatuses = (numSnapshots + statusEvery - 1) / statusEvery;
+    for (uint32_t i = 0; i < 500; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(receivedMux);
+            if (statuses.size() >= numStatuses)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    serverNetwork.deregisterCallback(&watcher);
+
+    std::lock_guard<std::mutex> lock(receivedMux);
+    std::cout << "Sent " << numSnapshots << " snapshots over a " << linkBitsPerSecond / 1000 << " kbit/s link: "
+        << snapshotsReceived << " arrived, " << serverNetwork.getDroppedSnapshots() << " were dropped, at most "
+        << mostQueued << " bytes were queued, and sending took " << totalSend << " ms (slowest " << slowestSend
+        << " ms) against " << linkMs << " ms on the link\n";
+
+    if (totalSend >= linkMs / 4)
+    {
+        std::cout << "TEST FAILURE: Sending to a slow station blocked the game master\n";
+        return 1;
+    }
+    // The newest snapshot is always kept, so the queue can go one snapshot over
+    if (mostQueued > Network::MaxQueuedBytes + 4096)
+    {
+        std::cout << "TEST FAILURE: The slow station's queue grew past its limit\n";
+        return 1;
+    }
+    if (serverNetwork.getDroppedSnapshots() == 0)
+    {
+        std::cout << "TEST FAILURE: No stale snapshots were dropped for the slow station\n";
+        return 1;
+    }
+
+    if (statuses.size() != numStatuses)
+    {
+        std::cout << "TEST FAILURE: " << statuses.size() << " of " << numStatuses << " status updates arrived\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < numStatuses; ++i)
+    {
+        if (statuses[i] != i)
+        {
+            std::cout << "TEST FAILURE: Status update " << statuses[i] << " arrived in place of " << i << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "TEST SUCCESS: Stale snapshots were dropped for a slow station, without blocking or losing status updates\n";
+    return 0;
+}
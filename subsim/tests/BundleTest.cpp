@@ -0,0 +1,217 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+#include "../common/Network.h"
+#include "../common/SimulationEvents.h"
+#include "../common/TickBundler.h"
+
+#include "BitStream.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+std::atomic<uint32_t> handled(0);
+std::mutex receivedMux;
+std::vector<int64_t> explosions;
+std::vector<uint32_t> scores;
+std::vector<UnitState> units;
+
+class BundleHandler : public EventReceiver
+{
+public:
+    BundleHandler(EventSystem* system)
+        : EventReceiver(system, {
+            dispatchEvent<BundleHandler, ExplosionEvent, &BundleHandler::handleExplosion>(),
+            dispatchEvent<BundleHandler, ScoreEvent, &BundleHandler::handleScore>(),
+            dispatchEvent<BundleHandler, UnitState, &BundleHandler::handleUnit>()})
+    {}
+
+    HandleResult handleExplosion(ExplosionEvent* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        explosions.push_back(event->x);
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleScore(ScoreEvent* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        scores.push_back(event->scores.at(1));
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleUnit(UnitState* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        units.push_back(*event);
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Sends a bundle through the wire format into the given system, as the network thread would
+void receive(const EnvelopeBundle& bundle, EventSystem* system)
+{
+    RakNet::BitStream packet;
+    bundle.serialize(packet);
+    EnvelopeBundle received(packet, RakNet::RakNetGUID(7), system);
+}
+
+bool waitForHandled(uint32_t count)
+{
+    for (uint32_t i = 0; i < 100 && handled < count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return handled == count;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr, false);
+    BundleHandler handler(&system);
+    TickBundler bundler(&system);
+
+    const RakNet::RakNetGUID first(1);
+    const RakNet::RakNetGUID second(2);
+    std::set<RakNet::RakNetGUID> clients = {first, second};
+
+    // A quiet tick fits in one bundle per client and delivery policy, with events in the order they were added
+    ExplosionEvent explosion;
+    explosion.y = 0;
+    explosion.size = 50;
+    for (int64_t x = 0; x < 3; ++x)
+    {
+        explosion.x = x;
+        bundler.add(explosion, clients);
+    }
+    ScoreEvent score;
+    score.scores[1] = 5;
+    bundler.add(score, first);
+
+    if (bundler.pending(first).size() != 2 || bundler.pending(first)[0].count != 3
+        || bundler.pending(first)[1].count != 1
+        || bundler.pending(second).size() != 1 || bundler.pending(second)[0].count != 3)
+    {
+        std::cout << "TEST FAILURE: Events were not gathered into one bundle per client and policy\n";
+        return 1;
+    }
+
+    // Snapshots are not resent if lost, but other events are
+    if (bundler.pending(first)[0].policy != EnvelopeMessage::deliveryPolicy(ExplosionEvent::category, ExplosionEvent::id)
+        || bundler.pending(first)[1].policy.reliability != UNRELIABLE_SEQUENCED
+        || bundler.pending(first)[1].policy.channel != Channels::Snapshots)
+    {
+        std::cout << "TEST FAILURE: Bundles do not carry the delivery policy of their events\n";
+        return 1;
+    }
+
+    receive(bundler.pending(first)[0], &system);
+    receive(bundler.pending(first)[1], &system);
+    if (!waitForHandled(4) || explosions != std::vector<int64_t>{0, 1, 2} || scores != std::vector<uint32_t>{5})
+    {
+        std::cout << "TEST FAILURE: Bundles were not unpacked in order\n";
+        return 1;
+    }
+
+    // A busy tick is split so that every bundle fits in a datagram
+    TickBundler busy(&system);
+    for (int64_t x = 0; x < 200; ++x)
+    {
+        explosion.x = x;
+        busy.add(explosion, first);
+    }
+    const std::vector<EnvelopeBundle>& bundles = busy.pending(first);
+    uint32_t total = 0;
+    for (const EnvelopeBundle& bundle : bundles)
+    {
+        RakNet::BitStream packet;
+        packet.Write((RakNet::MessageID)bundle.getType());
+        bundle.serialize(packet);
+        if (packet.GetNumberOfBytesUsed() > TickBundler::MaxBundleBytes)
+        {
+            std::cout << "TEST FAILURE: Bundle of " << packet.GetNumberOfBytesUsed() << " bytes is over the limit\n";
+            return 1;
+        }
+        total += bundle.count;
+    }
+    if (bundles.size() < 2 || total != 200)
+    {
+        std::cout << "TEST FAILURE: 200 explosions were split into " << bundles.size() << " bundles of "
+            << total << " events\n";
+        return 1;
+    }
+    Log::writeToLog(Log::INFO, "200 explosions took ", bundles.size(), " bundles");
+
+    handled = 0;
+    explosions.clear();
+    for (const EnvelopeBundle& bundle : bundles)
+    {
+        receive(bundle, &system);
+    }
+    if (!waitForHandled(200) || explosions.size() != 200 || explosions[199] != 199)
+    {
+        std::cout << "TEST FAILURE: Split bundles did not deliver every event in order\n";
+        return 1;
+    }
+
+    // Entries after the first start part way through a byte, where RakNet fails 0 byte reads. A sub's
+    // few tubes pack into under a byte, and an empty bulk vector has no bytes at all
+    TickBundler subs(&system);
+    UnitState unit = UnitState();
+    unit.team = 1;
+    unit.tubeIsArmed = {true, false, true};
+    unit.isStealth = true;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        unit.unit = i;
+        subs.add(unit, first);
+    }
+    if (subs.pending(first).size() != 1 || subs.pending(first)[0].count != 2)
+    {
+        std::cout << "TEST FAILURE: Unit states were not gathered into one bundle\n";
+        return 1;
+    }
+
+    handled = 0;
+    receive(subs.pending(first)[0], &system);
+    if (!waitForHandled(2) || units.size() != 2 || units[1].unit != 1
+        || units[1].tubeIsArmed != unit.tubeIsArmed || !units[1].tubeOccupancy.empty() || !units[1].isStealth)
+    {
+        std::cout << "TEST FAILURE: Short bool and empty bulk vectors did not survive a bundle\n";
+        return 1;
+    }
+
+    // A node that disconnected during the tick does not stop the others' bundles, or the next flush
+    Network network(false);
+    EventSystem sender(&network, false);
+    TickBundler orphaned(&sender);
+    orphaned.add(explosion, clients);
+    try
+    {
+        orphaned.flush();
+        orphaned.flush();
+    }
+    catch (NetworkMessageError&)
+    {
+        std::cout << "TEST FAILURE: Flushing bundles for a disconnected node threw\n";
+        return 1;
+    }
+    if (!orphaned.pending(first).empty())
+    {
+        std::cout << "TEST FAILURE: Bundles for a disconnected node were kept for the next flush\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Tick events were bundled per client\n";
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <iostream>
+
+std::atomic<bool> released(false);
+std::atomic<uint32_t> handled(0);
+std::atomic<uint32_t> lastSequence[2];
+
+class BlockEvent : public Event
+{
+public:
+    BlockEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 1;
+};
+
+class SnapshotEvent : public Event
+{
+public:
+    SnapshotEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 2;
+    constexpr static bool coalesce = true;
+
+    uint32_t coalesceKey() const { return team; }
+
+    uint32_t team;
+    uint32_t sequence;
+};
+
+/// Handles snapshots, after blocking until released on the first one it sees
+class SnapshotHandler : public EventReceiver
+{
+public:
+    SnapshotHandler(DeliveryMode mode)
+        : EventReceiver({
+            dispatchEvent<SnapshotHandler, BlockEvent, &SnapshotHandler::handleBlock>(),
+            dispatchEvent<SnapshotHandler, SnapshotEvent, &SnapshotHandler::handleSnapshot>(),
+        }, mode)
+    {}
+
+    HandleResult handleBlock(BlockEvent* event)
+    {
+        while (!released)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleSnapshot(SnapshotEvent* event)
+    {
+        lastSequence[event->team] = event->sequence;
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Queues snapshots for two teams behind a stalled receiver, returning false if they were not coalesced
+bool runStall(EventSystem& system, DeliveryMode mode)
+{
+    const uint32_t numSnapshots = 50;
+    released = false;
+    handled = 0;
+    uint64_t dropsBefore = system.getCoalescedDrops();
+
+    SnapshotHandler handler(mode);
+    system.queueEvent(BlockEvent());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    SnapshotEvent snapshot;
+    for (uint32_t i = 0; i < numSnapshots; ++i)
+    {
+        for (uint32_t team = 0; team < 2; ++team)
+        {
+            snapshot.team = team;
+            snapshot.sequence = i;
+            system.queueEvent(snapshot);
+        }
+        // Give the delivery thread a chance to hand snapshots to the mailbox
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    released = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    uint64_t drops = system.getCoalescedDrops() - dropsBefore;
+    std::cout << "Stalled receiver handled " << handled << " snapshots, " << drops << " coalesced\n";
+    return handled == 2 && drops == 2 * numSnapshots - 2
+        && lastSequence[0] == numSnapshots - 1 && lastSequence[1] == numSnapshots - 1;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr);
+
+    // Snapshots waiting in the queue behind a stalled delivery thread
+    if (!runStall(system, DeliveryMode::Inline))
+    {
+        std::cout << "TEST FAILURE: Queued snapshots were not coalesced\n";
+        return 1;
+    }
+
+    // Snapshots waiting in the mailbox of a stalled receiver
+    if (!runStall(system, DeliveryMode::Mailbox))
+    {
+        std::cout << "TEST FAILURE: Mailbox snapshots were not coalesced\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Only the newest snapshot of each key was delivered\n";
+    return 0;
+}
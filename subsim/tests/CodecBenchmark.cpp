@@ -0,0 +1,345 @@
+#include "../common/Log.h"
+#include "../common/BitStreamHelper.h"
+#include "../common/ConfigParser.h"
+#include "../common/EventCodec.h"
+#include "../common/Messages.h"
+#include "../common/SimulationEvents.h"
+
+#include "BitStream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Times encoding and decoding every event type registered in Envelope.cpp, plus the
+ * BitStreamHelper container paths they are built on, and reports ns and bytes per op.
+ *
+ * Payloads are sized like a busy game: six subs, 200 torpedos and 100 mines on a 50x50
+ * cell map (the largest shipped). Encoding goes through EnvelopeMessage::serializeEvent;
+ * decoding reads into a reused event, as the pooled decoder does, without queueing it.
+ *
+ * Usage: codec_benchmark [budget_ns]
+ * With a budget, exits with 1 if any encode or decode takes longer than that per op, so
+ * the serialization path can be held to it as events grow.
+ */
+
+/// Runs op repeatedly for at least 20 ms, returning the average ns per call
+template <typename Op>
+double timePerOp(Op op)
+{
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        op();
+    }
+
+    uint64_t ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed(0);
+    for (uint64_t batch = 16; elapsed < std::chrono::milliseconds(20); batch *= 2)
+    {
+        for (uint64_t i = 0; i < batch; ++i)
+        {
+            op();
+        }
+        ops += batch;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return elapsed.count() / ops;
+}
+
+double budget = 0;
+bool overBudget = false;
+
+void report(const char* name, double encodeNs, double decodeNs, size_t bytes)
+{
+    bool over = budget > 0 && (encodeNs > budget || decodeNs > budget);
+    overBudget = overBudget || over;
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(0)
+        << std::setw(12) << encodeNs << std::setw(12) << decodeNs << std::setw(10) << bytes
+        << (over ? "  OVER BUDGET" : "") << "\n";
+}
+
+template <typename T>
+void benchmarkEvent(const char* name, const T& event)
+{
+    RakNet::BitStream stream;
+    double encodeNs = timePerOp([&]
+        {
+            stream.Reset();
+            EnvelopeMessage::serializeEvent(event, stream);
+        });
+
+    T decoded;
+    double decodeNs = timePerOp([&]
+        {
+            stream.ResetReadPointer();
+            FieldReader reader(stream);
+            T::fields(decoded, reader);
+        });
+
+    report(name, encodeNs, decodeNs, stream.GetNumberOfBytesUsed());
+}
+
+template <typename T>
+void benchmarkContainer(const char* name, const T& value)
+{
+    RakNet::BitStream stream;
+    double encodeNs = timePerOp([&]
+        {
+            stream.Reset();
+            stream << value;
+        });
+
+    T decoded;
+    double decodeNs = timePerOp([&]
+        {
+            stream.ResetReadPointer();
+            stream >> decoded;
+        });
+
+    report(name, encodeNs, decodeNs, stream.GetNumberOfBytesUsed());
+}
+
+/// A 50x50 cell map: a walled border and scattered rocks
+Terrain makeTerrain()
+{
+    Terrain terrain;
+    terrain.width = terrain.height = 50;
+    terrain.scale = 1000;
+    terrain.map.resize(terrain.width * terrain.height, uint32_t(Terrain::EMPTY));
+    for (uint32_t y = 0; y < terrain.height; ++y)
+    {
+        for (uint32_t x = 0; x < terrain.width; ++x)
+        {
+            bool border = x == 0 || y == 0 || x + 1 == terrain.width || y + 1 == terrain.height;
+            if (border || (x * 7 + y * 13) % 17 == 0)
+            {
+                terrain.map[x + y * terrain.width] = Terrain::WALL;
+            }
+        }
+    }
+    return terrain;
+}
+
+UnitState makeUnitState(uint32_t team, uint32_t unit)
+{
+    UnitState state;
+    state.team = team;
+    state.unit = unit;
+    state.tubeIsArmed = {true, false, true, false, false};
+    state.tubeOccupancy = std::vector<UnitState::TubeStatus>(5, UnitState::Torpedo);
+    state.remainingTorpedos = 10;
+    state.remainingMines = 5;
+    state.torpedoDistance = 5000;
+    state.x = state.y = state.depth = 1000;
+    state.heading = 90;
+    state.direction = UnitState::Center;
+    state.pitch = 0;
+    state.speed = state.desiredSpeed = 4;
+    state.powerAvailable = 100;
+    state.powerUsage = 8;
+    state.isStealth = state.respawning = false;
+    state.stealthCooldown = state.respawnCooldown = 0;
+    state.yawEnabled = state.pitchEnabled = state.engineEnabled = true;
+    state.commsEnabled = state.sonarEnabled = state.weaponsEnabled = true;
+    state.targetIsLocked = false;
+    state.targetTeam = state.targetUnit = 0;
+    state.hasFlag = false;
+    state.flag.team = state.flag.index = 0;
+    return state;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    if (argc > 1)
+    {
+        budget = std::atof(argv[1]);
+    }
+
+    const uint32_t subs = 6, torpedos = 200, mines = 100;
+    Terrain terrain = makeTerrain();
+    const uint32_t mapSize = terrain.width * terrain.scale;
+
+    std::cout << std::left << std::setw(28) << "payload" << std::right
+        << std::setw(12) << "encode ns" << std::setw(12) << "decode ns" << std::setw(10) << "bytes" << "\n";
+
+    // Every type in Envelope.cpp's codec registry, in the same order
+
+    SimulationStart start;
+    for (uint32_t i = 0; i < subs; ++i)
+    {
+        start.stations.push_back(SimulationStart::Station{i % 2, i / 2, i % 2 == 0 ? Helm : Tactical});
+    }
+    start.teamNames = {{0, "Red October"}, {1, "Nautilus"}};
+    benchmarkEvent("SimulationStart", start);
+
+    benchmarkEvent("UnitState", makeUnitState(1, 2));
+
+    SonarDisplayState sonar;
+    sonar.mapWidth = sonar.mapHeight = mapSize;
+    for (uint32_t i = 0; i < subs; ++i)
+    {
+        UnitSonarState unit;
+        unit.team = i % 2;
+        unit.unit = i / 2;
+        unit.x = 5000 + i * 7000;
+        unit.y = 45000 - i * 7000;
+        unit.heading = i * 60;
+        unit.speed = 20;
+        unit.power = 100;
+        unit.hasFlag = unit.isStealth = unit.respawning = false;
+        unit.stealthCooldown = unit.respawnCooldown = 0;
+        sonar.units.push_back(unit);
+    }
+    for (uint32_t i = 0; i < torpedos; ++i)
+    {
+        sonar.torpedos.push_back(TorpedoState{(i * 7919) % mapSize, (i * 104729) % mapSize, (uint16_t)(i % 360)});
+    }
+    for (uint32_t i = 0; i < mines; ++i)
+    {
+        sonar.mines.push_back(MineState{(i * 4409) % mapSize, (i * 6661) % mapSize});
+    }
+    for (uint32_t i = 0; i < subs; ++i)
+    {
+        sonar.flags.push_back(FlagState{i % 2, 1000 + i * 8000, 25000, false});
+    }
+    benchmarkEvent("SonarDisplayState", sonar);
+
+    ThrottleEvent throttle;
+    throttle.team = throttle.unit = 1;
+    throttle.desiredSpeed = 20;
+    benchmarkEvent("ThrottleEvent", throttle);
+
+    TubeLoadEvent load;
+    load.team = load.unit = 1;
+    load.tube = 3;
+    load.type = TubeLoadEvent::Mine;
+    benchmarkEvent("TubeLoadEvent", load);
+
+    TubeArmEvent arm;
+    arm.team = arm.unit = 1;
+    arm.tube = 3;
+    arm.isArmed = true;
+    benchmarkEvent("TubeArmEvent", arm);
+
+    SteeringEvent steering;
+    steering.team = steering.unit = 1;
+    steering.direction = SteeringEvent::Left;
+    steering.isPressed = true;
+    benchmarkEvent("SteeringEvent", steering);
+
+    FireEvent fire;
+    fire.team = fire.unit = 1;
+    benchmarkEvent("FireEvent", fire);
+
+    RangeEvent range;
+    range.team = range.unit = 1;
+    range.range = 8000;
+    benchmarkEvent("RangeEvent", range);
+
+    PowerEvent power;
+    power.team = power.unit = 1;
+    power.system = PowerEvent::Sonar;
+    power.isOn = false;
+    benchmarkEvent("PowerEvent", power);
+
+    StealthEvent stealth;
+    stealth.team = stealth.unit = 1;
+    stealth.isStealth = true;
+    benchmarkEvent("StealthEvent", stealth);
+
+    ExplosionEvent explosion;
+    explosion.x = explosion.y = 12345;
+    explosion.size = 3;
+    benchmarkEvent("ExplosionEvent", explosion);
+
+    // As the game master sends it: the map itself is left out in favour of its hash
+    ConfigEvent config;
+    config.terrainHash = 0x0123456789ABCDEFull;
+    config.config.terrain.width = terrain.width;
+    config.config.terrain.height = terrain.height;
+    config.config.terrain.scale = terrain.scale;
+    for (uint32_t i = 0; i < subs; ++i)
+    {
+        config.config.startLocations[i % 2].push_back(std::make_pair(i * 5000, i * 3000));
+        config.config.flags[i % 2].push_back(std::make_pair(i * 4000, i * 2000));
+    }
+    for (uint32_t i = 0; i < mines; ++i)
+    {
+        config.config.mines.push_back(std::make_pair(sonar.mines[i].x, sonar.mines[i].y));
+    }
+    config.config.subTurningSpeed = config.config.subAcceleration = config.config.subMaxSpeed = 10;
+    config.config.stealthSpeedLimit = config.config.maxTorpedos = config.config.maxMines = 10;
+    config.config.sonarRange = config.config.passiveSonarNoiseFloor = config.config.torpedoSpread = 10;
+    config.config.torpedoSpeed = config.config.collisionRadius = config.config.torpedoDamage = 10;
+    config.config.mineDamage = config.config.collisionDamage = config.config.mineExclusionRadius = 10;
+    config.config.frameMilliseconds = config.config.stealthCooldown = config.config.respawnCooldown = 10;
+    benchmarkEvent("ConfigEvent", config);
+
+    ScoreEvent score;
+    score.scores = {{0, 3}, {1, 5}};
+    benchmarkEvent("ScoreEvent", score);
+
+    StatusUpdateEvent status;
+    status.team = status.unit = 1;
+    status.type = StatusUpdateEvent::FlagTaken;
+    benchmarkEvent("StatusUpdateEvent", status);
+
+    UnitStateDelta full;
+    full.team = full.unit = 1;
+    full.sequence = 1;
+    full.baseline = 0;
+    full.state = makeUnitState(1, 1);
+    full.mask = ~0ull;
+    benchmarkEvent("UnitStateDelta (full)", full);
+
+    // A typical tick: the sub moved and turned
+    UnitStateDelta moved = full;
+    moved.sequence = 2;
+    moved.baseline = 1;
+    moved.state.x += 40;
+    moved.state.y += 30;
+    moved.state.heading += 5;
+    moved.mask = deltaMask(moved.state, full.state);
+    benchmarkEvent("UnitStateDelta (moved)", moved);
+
+    UnitStateAck ack;
+    ack.team = ack.unit = 1;
+    ack.sequence = 2;
+    benchmarkEvent("UnitStateAck", ack);
+
+    TerrainRequest request;
+    request.hash = config.terrainHash;
+    benchmarkEvent("TerrainRequest", request);
+
+    TerrainData data;
+    data.hash = config.terrainHash;
+    data.terrain = terrain;
+    benchmarkEvent("TerrainData", data);
+
+    // The BitStreamHelper paths underneath
+    std::cout << "\n";
+    benchmarkContainer("string", std::string("Red October"));
+    benchmarkContainer("vector<uint32_t> (cells)", terrain.map);
+    std::vector<bool> walls(terrain.map.size());
+    for (size_t i = 0; i < walls.size(); ++i)
+    {
+        walls[i] = terrain.map[i] == Terrain::WALL;
+    }
+    benchmarkContainer("vector<bool> (cells)", walls);
+    benchmarkContainer("vector<pair> (mines)", config.config.mines);
+    benchmarkContainer("map<uint32_t, uint32_t>", score.scores);
+    benchmarkContainer("map<uint32_t, string>", start.teamNames);
+
+    return overBudget ? 1 : 0;
+}
@@ -0,0 +1,312 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Exceptions.h"
+#include "../common/Messages.h"
+#include "../common/SimulationEvents.h"
+
+#include "BitStream.h"
+#include "BitStreamHelper.h"
+
+#include <atomic>
+#include <iostream>
+
+std::atomic<uint32_t> handled(0);
+UnitState receivedUnit;
+SonarDisplayState receivedSonar;
+ConfigEvent receivedConfig;
+SimulationStart receivedStart;
+
+class CodecHandler : public EventReceiver
+{
+public:
+    CodecHandler(EventSystem* system)
+        : EventReceiver(system, {
+            dispatchEvent<CodecHandler, UnitState, &CodecHandler::handleUnit>(),
+            dispatchEvent<CodecHandler, SonarDisplayState, &CodecHandler::handleSonar>(),
+            dispatchEvent<CodecHandler, ConfigEvent, &CodecHandler::handleConfig>(),
+            dispatchEvent<CodecHandler, SimulationStart, &CodecHandler::handleStart>()})
+    {}
+
+    HandleResult handleUnit(UnitState* event)
+    {
+        receivedUnit = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleSonar(SonarDisplayState* event)
+    {
+        receivedSonar = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleConfig(ConfigEvent* event)
+    {
+        receivedConfig = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleStart(SimulationStart* event)
+    {
+        receivedStart = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Encodes the event, checks the size estimate, and decodes it back into the given system
+bool roundTrip(const Event& event, EventSystem* system, RakNet::BitStream& stream)
+{
+    size_t start = stream.GetNumberOfBitsUsed();
+    if (!EnvelopeMessage::serializeEvent(event, stream))
+    {
+        std::cout << "TEST FAILURE: Event id=" << event.i_id << " has no codec\n";
+        return false;
+    }
+    if (stream.GetNumberOfBitsUsed() - start != EnvelopeMessage::estimateEventBits(event))
+    {
+        std::cout << "TEST FAILURE: Event id=" << event.i_id << " took " << stream.GetNumberOfBitsUsed() - start
+            << " bits, but was estimated at " << EnvelopeMessage::estimateEventBits(event) << "\n";
+        return false;
+    }
+    stream.SetReadOffset(start);
+    return EnvelopeMessage::deserializeEvent(event.i_category, event.i_id, stream, system);
+}
+
+/// Returns true if both streams hold exactly the same bits
+bool sameBits(RakNet::BitStream& a, RakNet::BitStream& b)
+{
+    if (a.GetNumberOfBitsUsed() != b.GetNumberOfBitsUsed())
+    {
+        return false;
+    }
+    a.ResetReadPointer();
+    b.ResetReadPointer();
+    for (uint32_t i = 0; i < a.GetNumberOfBitsUsed(); ++i)
+    {
+        if (a.ReadBit() != b.ReadBit())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr, false);
+    CodecHandler handler(&system);
+
+    UnitState unit;
+    unit.team = 1;
+    unit.unit = 2;
+    unit.tubeIsArmed = {true, false, true};
+    unit.tubeOccupancy = {UnitState::Torpedo, UnitState::Empty, UnitState::Mine};
+    unit.remainingTorpedos = 5;
+    unit.remainingMines = 3;
+    unit.torpedoDistance = 1ull << 40;
+    unit.x = -123456789;
+    unit.y = 987654321;
+    unit.depth = -50;
+    unit.heading = 359;
+    unit.direction = UnitState::Right;
+    unit.pitch = -15;
+    unit.speed = 7;
+    unit.desiredSpeed = 9;
+    unit.powerAvailable = -3;
+    unit.powerUsage = 11;
+    unit.isStealth = true;
+    unit.stealthCooldown = 1000;
+    unit.respawning = false;
+    unit.respawnCooldown = 0;
+    unit.yawEnabled = unit.engineEnabled = unit.sonarEnabled = true;
+    unit.pitchEnabled = unit.commsEnabled = unit.weaponsEnabled = false;
+    unit.targetIsLocked = true;
+    unit.targetTeam = 2;
+    unit.targetUnit = 0;
+    unit.hasFlag = true;
+    unit.flag.team = 2;
+    unit.flag.index = 1;
+
+    // The generated encoding must match the hand-written one it replaced
+    RakNet::BitStream legacy;
+    legacy
+        << unit.team << unit.unit
+        << unit.tubeIsArmed << unit.tubeOccupancy << unit.remainingTorpedos << unit.remainingMines << unit.torpedoDistance
+        << unit.x << unit.y << unit.depth << unit.heading << unit.direction << unit.pitch
+        << unit.speed << unit.desiredSpeed
+        << unit.powerAvailable << unit.powerUsage << unit.isStealth << unit.stealthCooldown
+        << unit.respawning << unit.respawnCooldown
+        << unit.yawEnabled << unit.pitchEnabled << unit.engineEnabled << unit.commsEnabled << unit.sonarEnabled
+        << unit.weaponsEnabled
+        << unit.targetIsLocked << unit.targetTeam << unit.targetUnit
+        << unit.hasFlag << unit.flag.team << unit.flag.index;
+
+    RakNet::BitStream unitStream;
+    if (!roundTrip(unit, &system, unitStream))
+    {
+        return 1;
+    }
+    if (!sameBits(legacy, unitStream))
+    {
+        std::cout << "TEST FAILURE: UnitState wire format changed\n";
+        return 1;
+    }
+
+    SonarDisplayState sonar;
+    sonar.mapWidth = 40000;
+    sonar.mapHeight = 41000;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        UnitSonarState dot;
+        dot.team = i;
+        dot.unit = i + 1;
+        dot.x = i * 1000;
+        dot.y = 41000 - (int64_t)i;
+        dot.heading = i * 90;
+        dot.speed = 3;
+        dot.power = 10;
+        dot.hasFlag = i == 2;
+        dot.isStealth = i == 1;
+        dot.stealthCooldown = 0;
+        dot.respawning = false;
+        dot.respawnCooldown = 0;
+        sonar.units.push_back(dot);
+    }
+    sonar.torpedos.push_back(TorpedoState{1, 2, 45});
+    sonar.mines.push_back(MineState{4, 5});
+    sonar.flags.push_back(FlagState{1, 7, 8, true});
+
+    RakNet::BitStream sonarStream;
+    if (!roundTrip(sonar, &system, sonarStream))
+    {
+        return 1;
+    }
+
+    ConfigEvent config;
+    config.config.terrain.width = 64;
+    config.config.terrain.height = 48;
+    config.config.terrain.scale = 100;
+    config.config.terrain.map.resize(64 * 48, uint32_t(Terrain::EMPTY));
+    for (uint32_t i = 0; i < config.config.terrain.map.size(); i += 7)
+    {
+        config.config.terrain.map[i] = Terrain::WALL;
+    }
+    // Only walls are sent; start, flag and mine pixels were already read into the config
+    config.config.terrain.map[1] = Terrain::START1;
+    config.config.startLocations[0] = {{100, 200}, {300, 400}};
+    config.config.flags[1] = {{-5, 5}};
+    config.config.mines = {{1, 2}};
+    config.config.subMaxSpeed = 12;
+    config.config.respawnCooldown = 5000;
+
+    RakNet::BitStream configStream;
+    // Start the config part-way through a byte, so the bulk map copy is unaligned
+    configStream.Write(true);
+    configStream.Write(false);
+    if (!roundTrip(config, &system, configStream))
+    {
+        return 1;
+    }
+
+    SimulationStart start;
+    start.stations.push_back(SimulationStart::Station{0, 1, StationType::Helm});
+    start.stations.push_back(SimulationStart::Station{1, 0, StationType::Tactical});
+    start.teamNames[0] = "Red";
+    start.teamNames[1] = "Blue";
+
+    RakNet::BitStream startStream;
+    if (!roundTrip(start, &system, startStream))
+    {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < 100 && handled < 4; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (handled != 4)
+    {
+        std::cout << "TEST FAILURE: Only " << handled << " of 4 decoded events were delivered\n";
+        return 1;
+    }
+
+    if (receivedUnit.x != unit.x || receivedUnit.torpedoDistance != unit.torpedoDistance
+        || receivedUnit.tubeIsArmed != unit.tubeIsArmed || receivedUnit.tubeOccupancy != unit.tubeOccupancy
+        || receivedUnit.direction != unit.direction || receivedUnit.powerAvailable != unit.powerAvailable
+        || receivedUnit.weaponsEnabled != unit.weaponsEnabled || receivedUnit.flag.index != unit.flag.index)
+    {
+        std::cout << "TEST FAILURE: UnitState did not survive the round trip\n";
+        return 1;
+    }
+    if (receivedSonar.units.size() != 4 || receivedSonar.units[3].heading != 270 || receivedSonar.units[3].x != 3000 || receivedSonar.units[3].y != 40997
+        || !receivedSonar.units[2].hasFlag || receivedSonar.torpedos.at(0).heading != 45
+        || receivedSonar.mines.at(0).y != 5 || !receivedSonar.flags.at(0).isTaken)
+    {
+        std::cout << "TEST FAILURE: SonarDisplayState did not survive the round trip\n";
+        return 1;
+    }
+    config.config.terrain.map[1] = Terrain::EMPTY;
+    if (receivedConfig.config.terrain.map != config.config.terrain.map
+        || receivedConfig.config.terrain.height != 48
+        || receivedConfig.config.startLocations != config.config.startLocations
+        || receivedConfig.config.flags != config.config.flags
+        || receivedConfig.config.subMaxSpeed != 12 || receivedConfig.config.respawnCooldown != 5000)
+    {
+        std::cout << "TEST FAILURE: ConfigEvent did not survive the round trip\n";
+        return 1;
+    }
+    if (receivedStart.stations.size() != 2 || receivedStart.stations[1].station != StationType::Tactical
+        || receivedStart.teamNames != start.teamNames)
+    {
+        std::cout << "TEST FAILURE: SimulationStart did not survive the round trip\n";
+        return 1;
+    }
+
+    // The terrain goes as run lengths: 64 x 48 cells with a wall every 7 take about 500 bytes, not 12 kB
+    if (EnvelopeMessage::estimateEventBits(config) > 8 * 1024)
+    {
+        std::cout << "TEST FAILURE: ConfigEvent took " << EnvelopeMessage::estimateEventBits(config) / 8 << " bytes\n";
+        return 1;
+    }
+
+    // Positions are exact up to 16 bits of map size, and off-map positions are clamped to its edges
+    PositionCoding coding(41000);
+    if (coding.bits != 16 || coding.decode(coding.encode(40999)) != 40999
+        || coding.decode(coding.encode(-20)) != 0 || coding.decode(coding.encode(50000)) != 41000)
+    {
+        std::cout << "TEST FAILURE: Positions were not quantized exactly on a 41000 unit map\n";
+        return 1;
+    }
+    // Larger maps drop low bits, landing within half a step of the true position
+    PositionCoding coarse(1000000);
+    if (coarse.bits != 16 || coarse.shift != 4 || coarse.decode(coarse.encode(123456)) - 123456 > 8
+        || 123456 - coarse.decode(coarse.encode(123456)) > 8)
+    {
+        std::cout << "TEST FAILURE: Positions were not quantized to 16 bits on a large map\n";
+        return 1;
+    }
+
+    // A truncated message must be rejected, not read past its end
+    RakNet::BitStream truncated(configStream.GetData(), 64, false);
+    truncated.IgnoreBits(2);
+    try
+    {
+        EnvelopeMessage::deserializeEvent(config.i_category, config.i_id, truncated, &system);
+        std::cout << "TEST FAILURE: Truncated ConfigEvent was accepted\n";
+        return 1;
+    }
+    catch (NetworkMessageError&)
+    {
+    }
+
+    std::cout << "TEST SUCCESS: Events round-tripped through their field lists\n";
+    return 0;
+}
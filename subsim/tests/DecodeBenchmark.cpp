@@ -0,0 +1,188 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/EventCodec.h"
+#include "../common/Messages.h"
+#include "../common/SimulationEvents.h"
+
+#include "BitStream.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+
+/*
+ * Measures what the network thread spends per received packet decoding an event and
+ * queueing it: the time, and the heap allocations it makes.
+ *
+ * Decoding straight into a pooled event (EnvelopeMessage::deserializeEvent) is compared
+ * against the previous path, which decoded into a stack event and then moved it into
+ * the EventSystem, reallocating every container along the way.
+ */
+
+std::atomic<uint64_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+std::atomic<uint64_t> handled(0);
+
+class Sink : public EventReceiver
+{
+public:
+    Sink(EventSystem* system)
+        : EventReceiver(system, {
+            dispatchEvent<Sink, SonarDisplayState, &Sink::handleSonar>(),
+            dispatchEvent<Sink, UnitState, &Sink::handleUnit>()})
+    {}
+
+    HandleResult handleSonar(SonarDisplayState* event)
+    {
+        ++handled;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleUnit(UnitState* event)
+    {
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// The decoder as it was before events were decoded into pooled storage
+template <typename T>
+void copyingDecode(RakNet::BitStream& stream, EventSystem* events)
+{
+    T event;
+    FieldReader reader(stream);
+    T::fields(event, reader);
+    events->queueEvent(std::move(event));
+}
+
+/// Decodes the packet the given number of times, returning ns and allocations per packet
+template <typename T, typename Decode>
+void run(RakNet::BitStream& packet, EventSystem* system, uint32_t packets, Decode decode,
+    double& nsPerPacket, double& allocationsPerPacket)
+{
+    // Warm up the pools, then let delivery catch up so each run starts idle
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        packet.ResetReadPointer();
+        decode(packet, system);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t startAllocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < packets; ++i)
+    {
+        packet.ResetReadPointer();
+        decode(packet, system);
+    }
+    nsPerPacket = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / packets;
+    allocationsPerPacket = (double)(allocations - startAllocations) / packets;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+template <typename T>
+void compare(const char* name, const T& event, EventSystem* system)
+{
+    RakNet::BitStream packet;
+    EnvelopeMessage::serializeEvent(event, packet);
+
+    const uint32_t packets = 200000;
+    double copyingNs, copyingAllocations, pooledNs, pooledAllocations;
+    run<T>(packet, system, packets, &copyingDecode<T>, copyingNs, copyingAllocations);
+    run<T>(packet, system, packets,
+        [](RakNet::BitStream& stream, EventSystem* events)
+        {
+            EnvelopeMessage::deserializeEvent(T::category, T::id, stream, events);
+        },
+        pooledNs, pooledAllocations);
+
+    std::cout << name << " (" << packet.GetNumberOfBytesUsed() << " bytes) | "
+        << copyingNs << " ns, " << copyingAllocations << " allocs | "
+        << pooledNs << " ns, " << pooledAllocations << " allocs\n";
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    EventSystem system(nullptr, false);
+    Sink sink(&system);
+
+    // A busy tick on a 40x40 map: six subs, a dozen torpedos, the mines and flags
+    SonarDisplayState sonar;
+    sonar.mapWidth = sonar.mapHeight = 40000;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        UnitSonarState unit;
+        unit.team = i % 2;
+        unit.unit = i / 2;
+        unit.x = 5000 + i * 5000;
+        unit.y = 35000 - i * 5000;
+        unit.heading = i * 60;
+        unit.speed = 20;
+        unit.power = 100;
+        unit.hasFlag = unit.isStealth = unit.respawning = false;
+        unit.stealthCooldown = unit.respawnCooldown = 0;
+        sonar.units.push_back(unit);
+        sonar.torpedos.push_back(TorpedoState{unit.x + 200, unit.y, unit.heading});
+        sonar.torpedos.push_back(TorpedoState{unit.x, unit.y + 200, unit.heading});
+    }
+    for (uint32_t i = 0; i < 40; ++i)
+    {
+        sonar.mines.push_back(MineState{i * 1000, 40000 - i * 1000});
+    }
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        sonar.flags.push_back(FlagState{i % 2, 1000 + i * 6000, 20000, false});
+    }
+
+    UnitState unit;
+    unit.team = 1;
+    unit.unit = 2;
+    unit.tubeIsArmed = {true, false, true, false, false};
+    unit.tubeOccupancy = std::vector<UnitState::TubeStatus>(5, UnitState::Torpedo);
+    unit.remainingTorpedos = 10;
+    unit.remainingMines = 5;
+    unit.torpedoDistance = 5000;
+    unit.x = unit.y = unit.depth = 1000;
+    unit.heading = 90;
+    unit.direction = UnitState::Center;
+    unit.pitch = 0;
+    unit.speed = unit.desiredSpeed = 4;
+    unit.powerAvailable = 100;
+    unit.powerUsage = 8;
+    unit.isStealth = unit.respawning = false;
+    unit.stealthCooldown = unit.respawnCooldown = 0;
+    unit.yawEnabled = unit.pitchEnabled = unit.engineEnabled = true;
+    unit.commsEnabled = unit.sonarEnabled = unit.weaponsEnabled = true;
+    unit.targetIsLocked = false;
+    unit.targetTeam = unit.targetUnit = 0;
+    unit.hasFlag = false;
+    unit.flag.team = unit.flag.index = 0;
+
+    std::cout << "event | stack decode + queue per packet | pooled decode per packet\n";
+    compare("SonarDisplayState", sonar, &system);
+    compare("UnitState", unit, &system);
+    return 0;
+}
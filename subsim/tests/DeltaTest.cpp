@@ -0,0 +1,235 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/EventCodec.h"
+#include "../common/Messages.h"
+#include "../common/SimulationEvents.h"
+#include "../common/UnitStateDelta.h"
+
+#include "BitStream.h"
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+std::atomic<uint32_t> handled(0);
+UnitState received;
+
+class StateHandler : public EventReceiver
+{
+public:
+    StateHandler(EventSystem* system)
+        : EventReceiver(system, {dispatchEvent<StateHandler, UnitState, &StateHandler::handleState>()})
+    {}
+
+    HandleResult handleState(UnitState* event)
+    {
+        received = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Keeps acks for the test to deliver (or lose) instead of sending them
+class TestDeltaReceiver : public UnitStateDeltaReceiver
+{
+public:
+    TestDeltaReceiver(EventSystem* system) : UnitStateDeltaReceiver(system), sentAcks(0) {}
+
+    std::vector<UnitStateAck> acks;
+    std::atomic<uint32_t> sentAcks;
+
+protected:
+    void sendAck(UnitStateAck&& ack) override
+    {
+        acks.push_back(std::move(ack));
+        ++sentAcks;
+    }
+};
+
+const RakNet::RakNetGUID client(42);
+
+/// Sends one tick's state through the wire format, returning the delta that was sent and its size in bits
+bool sendState(UnitStateBaselines& baselines, const UnitState& state, EventSystem* system,
+    UnitStateDelta& sent, size_t& bits)
+{
+    EnvelopeMessage envelope = baselines.makeEnvelope(state, client);
+    sent = *static_cast<UnitStateDelta*>(envelope.event.get());
+
+    RakNet::BitStream stream;
+    EnvelopeMessage::serializeEvent(*envelope.event, stream);
+    bits = stream.GetNumberOfBitsUsed();
+    return EnvelopeMessage::deserializeEvent(sent.i_category, sent.i_id, stream, system, client);
+}
+
+/// Waits for the given number of rebuilt states to be delivered
+bool waitForHandled(uint32_t count)
+{
+    for (uint32_t i = 0; i < 100 && handled < count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return handled == count;
+}
+
+/// Delivers the client's acks to the game master, marking them as coming from the test client
+void deliverAcks(TestDeltaReceiver& receiver, UnitStateBaselines& baselines)
+{
+    for (UnitStateAck& ack : receiver.acks)
+    {
+        ack.sender = client;
+        baselines.acknowledge(ack);
+    }
+    receiver.acks.clear();
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr, false);
+    StateHandler handler(&system);
+    TestDeltaReceiver receiver(&system);
+    UnitStateBaselines baselines;
+
+    UnitState state;
+    state.team = 1;
+    state.unit = 0;
+    state.tubeIsArmed = std::vector<bool>(5, false);
+    state.tubeOccupancy = std::vector<UnitState::TubeStatus>(5, UnitState::Torpedo);
+    state.remainingTorpedos = 10;
+    state.remainingMines = 5;
+    state.torpedoDistance = 5000;
+    state.x = state.y = state.depth = 0;
+    state.heading = 90;
+    state.direction = UnitState::Center;
+    state.pitch = 0;
+    state.speed = state.desiredSpeed = 4;
+    state.powerAvailable = 100;
+    state.powerUsage = 8;
+    state.isStealth = state.respawning = false;
+    state.stealthCooldown = state.respawnCooldown = 0;
+    state.yawEnabled = state.pitchEnabled = state.engineEnabled = true;
+    state.commsEnabled = state.sonarEnabled = state.weaponsEnabled = true;
+    state.targetIsLocked = false;
+    state.targetTeam = state.targetUnit = 0;
+    state.hasFlag = false;
+    state.flag.team = state.flag.index = 0;
+
+    UnitStateDelta sent;
+    size_t bits;
+    size_t fullBits = 0;
+    size_t deltaBits = 0;
+    uint32_t deltas = 0;
+    uint32_t ticks = 0;
+
+    // Moves the sub, sends its state, and checks the client rebuilt it exactly
+    auto tick = [&](bool deliverAck) -> bool
+    {
+        state.x += 12;
+        state.y -= 7;
+        if (ticks % 10 == 0)
+        {
+            state.tubeIsArmed[ticks % 5] = !state.tubeIsArmed[ticks % 5];
+        }
+        ++ticks;
+
+        if (!sendState(baselines, state, &system, sent, bits))
+        {
+            std::cout << "TEST FAILURE: UnitStateDelta has no codec\n";
+            return false;
+        }
+        if (sent.baseline == 0)
+        {
+            fullBits = bits;
+        } else {
+            deltaBits += bits;
+            ++deltas;
+        }
+        if (!waitForHandled(ticks) || deltaMask(received, state) != 0)
+        {
+            std::cout << "TEST FAILURE: Tick " << ticks << " was not rebuilt exactly\n";
+            return false;
+        }
+        if (deliverAck)
+        {
+            deliverAcks(receiver, baselines);
+        } else {
+            receiver.acks.clear();
+        }
+        return true;
+    };
+
+    for (uint32_t i = 0; i < 20; ++i)
+    {
+        if (!tick(true))
+        {
+            return 1;
+        }
+    }
+    if (deltas != 19 || deltaBits / deltas > fullBits / 3)
+    {
+        std::cout << "TEST FAILURE: " << deltas << " deltas averaged " << deltaBits / std::max(deltas, 1u)
+            << " bits, against " << fullBits << " for a full state\n";
+        return 1;
+    }
+    Log::writeToLog(Log::INFO, "Full state: ", fullBits, " bits, average delta: ", deltaBits / deltas, " bits");
+
+    // With every ack lost, deltas keep using the last baseline until it leaves the history
+    for (uint32_t i = 0; i < DeltaHistory; ++i)
+    {
+        if (!tick(false))
+        {
+            return 1;
+        }
+    }
+    if (sent.baseline != 0)
+    {
+        std::cout << "TEST FAILURE: No full state was sent after " << DeltaHistory << " lost acks\n";
+        return 1;
+    }
+    if (!tick(true) || !tick(true) || sent.baseline == 0)
+    {
+        std::cout << "TEST FAILURE: Deltas did not resume once acks got through\n";
+        return 1;
+    }
+
+    // After a reconnect, the client has no baselines, so it drops the delta and asks for a full state
+    receiver.reset();
+    state.x += 12;
+    if (!sendState(baselines, state, &system, sent, bits) || sent.baseline == 0)
+    {
+        std::cout << "TEST FAILURE: Expected a delta after the reconnect\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < 100 && receiver.sentAcks < ticks + 1; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (handled != ticks || receiver.acks.size() != 1 || receiver.acks[0].sequence != 0)
+    {
+        std::cout << "TEST FAILURE: Delta without a baseline was not rejected\n";
+        return 1;
+    }
+    deliverAcks(receiver, baselines);
+    if (!tick(true) || sent.baseline != 0 || !tick(true) || sent.baseline == 0)
+    {
+        std::cout << "TEST FAILURE: Did not recover from a lost baseline\n";
+        return 1;
+    }
+
+    // A disconnected client is forgotten, so anything sent to its GUID again starts from a full state
+    baselines.forget(client);
+    EnvelopeMessage afterForget = baselines.makeEnvelope(state, client);
+    const UnitStateDelta* first = static_cast<UnitStateDelta*>(afterForget.event.get());
+    if (first->sequence != 1 || first->baseline != 0)
+    {
+        std::cout << "TEST FAILURE: Baselines of a forgotten client were kept\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Unit states were delta encoded against acknowledged baselines\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/*
+ * Measures how EventSystem delivery cost scales with the number of registered
+ * receivers. Every receiver looks like a station: it handles several event
+ * types, but each benchmark event is only interesting to a single receiver.
+ *
+ * For reference, the cost of the old delivery strategy (offer every event to
+ * every handler of every receiver) is emulated on the same receiver set.
+ */
+
+std::atomic<uint64_t> handled(0);
+
+template <uint32_t N>
+class BenchEvent : public Event
+{
+public:
+    BenchEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 100;
+    constexpr static uint32_t id = N;
+};
+
+/// Receiver with eight handlers, offset so different receivers want different events
+class StationLike : public EventReceiver
+{
+public:
+    StationLike()
+        : EventReceiver({
+            dispatchEvent<StationLike, BenchEvent<0>, &StationLike::handle<0>>(),
+            dispatchEvent<StationLike, BenchEvent<1>, &StationLike::handle<1>>(),
+            dispatchEvent<StationLike, BenchEvent<2>, &StationLike::handle<2>>(),
+            dispatchEvent<StationLike, BenchEvent<3>, &StationLike::handle<3>>(),
+            dispatchEvent<StationLike, BenchEvent<4>, &StationLike::handle<4>>(),
+            dispatchEvent<StationLike, BenchEvent<5>, &StationLike::handle<5>>(),
+            dispatchEvent<StationLike, BenchEvent<6>, &StationLike::handle<6>>(),
+        })
+    {}
+
+    template <uint32_t N>
+    HandleResult handle(BenchEvent<N>* event)
+    {
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Receiver that is the only one interested in the benchmark event
+class Interested : public EventReceiver
+{
+public:
+    Interested()
+        : EventReceiver({dispatchEvent<Interested, BenchEvent<99>, &Interested::handle>()})
+    {}
+
+    HandleResult handle(BenchEvent<99>* event)
+    {
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Emulates the old delivery loop: every receiver, every handler, check the type at runtime
+uint64_t linearWalk(const std::vector<EventReceiver*>& receivers, Event* event)
+{
+    uint64_t checks = 0;
+    for (EventReceiver* receiver : receivers)
+    {
+        for (const EventDispatcher& dispatcher : receiver->dispatchers)
+        {
+            ++checks;
+            if (dispatcher.category == event->i_category && dispatcher.id == event->i_id)
+            {
+                if (dispatcher.handler(receiver, event) == HandleResult::Stop)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return checks;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::WARN);
+
+    const uint64_t numEvents = 200000;
+    EventSystem system(nullptr);
+
+    std::cout << "receivers | indexed EventSystem ns/event | linear walk ns/event (handler checks/event)\n";
+    for (uint32_t numReceivers : {4, 16, 48, 96, 192})
+    {
+        std::vector<std::unique_ptr<EventReceiver>> owned;
+        std::vector<EventReceiver*> receivers;
+        for (uint32_t i = 0; i + 1 < numReceivers; ++i)
+        {
+            owned.emplace_back(new StationLike);
+            receivers.push_back(owned.back().get());
+        }
+        owned.emplace_back(new Interested);
+        receivers.push_back(owned.back().get());
+
+        // End-to-end delivery through the real EventSystem
+        handled = 0;
+        BenchEvent<99> event;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < numEvents; ++i)
+        {
+            system.queueEvent(event);
+        }
+        while (handled < numEvents)
+        {
+            std::this_thread::yield();
+        }
+        double indexedNs = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / numEvents;
+
+        // Reference: the old O(receivers x handlers) walk, on the same receivers
+        uint64_t checks = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < numEvents; ++i)
+        {
+            checks = linearWalk(receivers, &event);
+        }
+        double linearNs = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / numEvents;
+
+        std::cout << numReceivers << " | " << indexedNs << " | " << linearNs << " (" << checks << ")\n";
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "../common/Log.h"
 #include "../common/EventSystem.h"
 
+#include <atomic>
 #include <iostream>
 
 int result = 1;
@@ -17,7 +18,7 @@ class TestHandler : public EventReceiver
 {
 public:
     TestHandler()
-        : EventReceiver({dispatchEvent<TestHandler, EventTest, &TestHandler::handleTest>})
+        : EventReceiver({dispatchEvent<TestHandler, EventTest, &TestHandler::handleTest>()})
     {}
 
     HandleResult handleTest(EventTest* test)
@@ -29,6 +30,42 @@ public:
 
 };
 
+class BatchEvent : public Event
+{
+public:
+    BatchEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 2;
+
+    uint32_t sequence;
+};
+
+class BatchHandler : public EventReceiver
+{
+public:
+    BatchHandler()
+        : EventReceiver({dispatchBatch<BatchHandler, BatchEvent, &BatchHandler::handleBatch>()})
+        , handled(0)
+        , calls(0)
+        , inOrder(true)
+    {}
+
+    HandleResult handleBatch(const EventBatch<BatchEvent>& events)
+    {
+        ++calls;
+        for (BatchEvent* event : events)
+        {
+            inOrder = inOrder && event->sequence == handled;
+            ++handled;
+        }
+        return HandleResult::Stop;
+    }
+
+    std::atomic<uint32_t> handled;
+    std::atomic<uint32_t> calls;
+    std::atomic<bool> inOrder;
+};
+
 int main(int argc, char **argv)
 {
     Log::setLogfile(std::string(argv[0]) + ".log");
@@ -36,11 +73,49 @@ int main(int argc, char **argv)
     Log::shouldMirrorToConsole(true);
     Log::setLogLevel(Log::ALL);
 
+    // The event system has to exist before any receivers hook into it
+    EventSystem system(nullptr);
     TestHandler handler;
     EventTest test;
-    EventSystem system(nullptr);
-    system.registerCallback(&handler);
     system.queueEvent(test);
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    LatencySummary latency = system.getLatencySummary(EventTest::category);
+    if (latency.count != 1)
+    {
+        std::cout << "TEST FAILURE: Expected one latency sample, got " << latency.count << "\n";
+        return 1;
+    }
+    std::cout << "Delivery latency: p50=" << latency.p50 << "us p99=" << latency.p99
+        << "us max=" << latency.max << "us\n";
+
+    // The delivered event went back to its pool, so a second one should reuse it
+    system.queueEvent(test);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    EventAllocationStats allocations = EventSystem::getAllocationStats();
+    if (allocations.allocated != 1 || allocations.reused != 1 || allocations.recycled != 2)
+    {
+        std::cout << "TEST FAILURE: Expected 1 allocation, 1 reuse and 2 recycles, got " << allocations.allocated
+            << ", " << allocations.reused << " and " << allocations.recycled << "\n";
+        return 1;
+    }
+
+    // Events of one type that are queued together arrive in a single batch, in order
+    BatchHandler batchHandler;
+    BatchEvent batchEvent;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        batchEvent.sequence = i;
+        system.queueEvent(batchEvent);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (batchHandler.handled != 100 || !batchHandler.inOrder)
+    {
+        std::cout << "TEST FAILURE: Batch handler saw " << batchHandler.handled << " of 100 events, in order: "
+            << batchHandler.inOrder << "\n";
+        return 1;
+    }
+    std::cout << "Batch handler received 100 events in " << batchHandler.calls << " calls\n";
     return result;
 }
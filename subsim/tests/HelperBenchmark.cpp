@@ -0,0 +1,135 @@
+#include "../common/Log.h"
+#include "../common/BitStreamHelper.h"
+
+#include "BitStream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/*
+ * Compares writing and reading vectors through BitStreamHelper's bulk paths against the
+ * previous element-at-a-time loops, on vectors the size of a terrain's cells.
+ *
+ * Both produce the same bits, which is checked before timing.
+ */
+
+/// The vector writer as it was before the bulk paths
+template <typename T>
+void elementWrite(RakNet::BitStream& stream, const std::vector<T>& values)
+{
+    uint32_t size = values.size();
+    stream.Write(size);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        stream.Write((T)values[i]);
+    }
+}
+
+/// The vector reader as it was before the bulk paths
+template <typename T>
+void elementRead(RakNet::BitStream& stream, std::vector<T>& values)
+{
+    uint32_t size;
+    stream >> size;
+    values.clear();
+    values.reserve(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        T value;
+        stream >> value;
+        values.push_back(value);
+    }
+}
+
+template <typename T>
+void bulkWrite(RakNet::BitStream& stream, const std::vector<T>& values)
+{
+    stream << values;
+}
+
+template <typename T>
+void bulkRead(RakNet::BitStream& stream, std::vector<T>& values)
+{
+    stream >> values;
+}
+
+/// Runs write then read the given number of times, returning the average ns of each
+template <typename T, typename Write, typename Read>
+void run(const std::vector<T>& values, uint32_t rounds, Write write, Read read,
+    double& writeNs, double& readNs)
+{
+    RakNet::BitStream stream;
+    std::vector<T> decoded;
+    writeNs = readNs = 0;
+    for (uint32_t i = 0; i < rounds; ++i)
+    {
+        stream.Reset();
+        auto start = std::chrono::steady_clock::now();
+        write(stream, values);
+        auto written = std::chrono::steady_clock::now();
+        read(stream, decoded);
+        auto done = std::chrono::steady_clock::now();
+
+        writeNs += std::chrono::duration<double, std::nano>(written - start).count();
+        readNs += std::chrono::duration<double, std::nano>(done - written).count();
+    }
+    writeNs /= rounds;
+    readNs /= rounds;
+
+    if (decoded != values)
+    {
+        std::cout << "Decoded vector does not match!\n";
+        std::exit(1);
+    }
+}
+
+template <typename T>
+void compare(const char* name, const std::vector<T>& values)
+{
+    RakNet::BitStream element, bulk;
+    elementWrite(element, values);
+    bulkWrite(bulk, values);
+    if (element.GetNumberOfBitsUsed() != bulk.GetNumberOfBitsUsed()
+        || !std::equal(element.GetData(), element.GetData() + element.GetNumberOfBytesUsed(), bulk.GetData()))
+    {
+        std::cout << name << ": bulk encoding differs from the element-at-a-time one!\n";
+        std::exit(1);
+    }
+
+    const uint32_t rounds = 200;
+    double elementWriteNs, elementReadNs, bulkWriteNs, bulkReadNs;
+    run(values, rounds, &elementWrite<T>, &elementRead<T>, elementWriteNs, elementReadNs);
+    run(values, rounds, &bulkWrite<T>, &bulkRead<T>, bulkWriteNs, bulkReadNs);
+
+    std::cout << name << " x " << values.size() << " (" << bulk.GetNumberOfBytesUsed() << " bytes) | "
+        << elementWriteNs / 1000 << " / " << elementReadNs / 1000 << " us | "
+        << bulkWriteNs / 1000 << " / " << bulkReadNs / 1000 << " us | "
+        << elementWriteNs / bulkWriteNs << "x / " << elementReadNs / bulkReadNs << "x\n";
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    std::cout << "vector | element write / read | bulk write / read | speedup\n";
+
+    // The shipped maps are at most 50x50 cells; larger sizes show how it scales
+    for (size_t side : {16, 50, 200})
+    {
+        std::vector<uint32_t> cells(side * side);
+        std::vector<bool> walls(side * side);
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            walls[i] = (i * 2654435761u) % 7 == 0;
+            cells[i] = walls[i] ? 1 : 0;
+        }
+        compare("uint32_t", cells);
+        compare("uint8_t", std::vector<uint8_t>(cells.begin(), cells.end()));
+        compare("bool", walls);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/EventJournal.h"
+#include "../common/SimulationEvents.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/// Local-only event, which the journal should skip
+class LocalEvent : public Event
+{
+public:
+    LocalEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 99;
+    constexpr static uint32_t id = 1;
+};
+
+std::atomic<uint32_t> handled(0);
+std::vector<uint16_t> speeds;
+
+class ThrottleHandler : public EventReceiver
+{
+public:
+    ThrottleHandler(EventSystem* system)
+        : EventReceiver(system, {dispatchEvent<ThrottleHandler, ThrottleEvent, &ThrottleHandler::handleThrottle>()})
+    {}
+
+    HandleResult handleThrottle(ThrottleEvent* event)
+    {
+        speeds.push_back(event->desiredSpeed);
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Replays the journal into a fresh EventSystem, checking every event arrives in order
+bool replayAndCheck(const std::string& filename, ReplaySpeed speed, uint32_t numEvents)
+{
+    handled = 0;
+    speeds.clear();
+
+    EventSystem system(nullptr, false);
+    ThrottleHandler handler(&system);
+    if (EventJournal::replay(filename, &system, speed) != numEvents)
+    {
+        std::cout << "TEST FAILURE: Journal did not hold " << numEvents << " events\n";
+        return false;
+    }
+    for (uint32_t i = 0; i < 100 && handled < numEvents; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (handled != numEvents)
+    {
+        std::cout << "TEST FAILURE: Replay delivered " << handled << " of " << numEvents << " events\n";
+        return false;
+    }
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+        if (speeds[i] != i)
+        {
+            std::cout << "TEST FAILURE: Replayed event " << i << " had speed " << speeds[i] << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    const std::string filename = std::string(argv[0]) + ".journal";
+    const uint32_t numEvents = 200;
+    const auto gap = std::chrono::milliseconds(50);
+
+    {
+        EventSystem system(nullptr);
+        std::unique_ptr<EventJournal> journal(new EventJournal(&system, filename));
+
+        ThrottleEvent throttle;
+        throttle.team = 1;
+        throttle.unit = 2;
+        for (uint32_t i = 0; i < numEvents; ++i)
+        {
+            throttle.desiredSpeed = i;
+            system.queueEvent(throttle);
+            system.queueEvent(LocalEvent());
+            // Leave a gap before the last event, so wall-clock replay has something to wait for
+            if (i == numEvents - 2)
+            {
+                std::this_thread::sleep_for(gap);
+            }
+        }
+
+        for (uint32_t i = 0; i < 100 && journal->getRecorded() + journal->getSkipped() < 2 * numEvents; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (journal->getRecorded() != numEvents || journal->getSkipped() != numEvents)
+        {
+            std::cout << "TEST FAILURE: Journal recorded " << journal->getRecorded() << " and skipped "
+                << journal->getSkipped() << " events\n";
+            return 1;
+        }
+    }
+
+    if (!replayAndCheck(filename, ReplaySpeed::Maximum, numEvents))
+    {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!replayAndCheck(filename, ReplaySpeed::WallClock, numEvents))
+    {
+        return 1;
+    }
+    if (std::chrono::steady_clock::now() - start < gap)
+    {
+        std::cout << "TEST FAILURE: Wall-clock replay did not keep the recorded spacing\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Journalled events were replayed in order\n";
+    return 0;
+}
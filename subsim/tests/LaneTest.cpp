@@ -0,0 +1,136 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <iostream>
+
+std::atomic<bool> released(false);
+std::atomic<uint32_t> highHandled(0);
+std::atomic<uint32_t> lowHandled(0);
+/// Number of low priority events delivered before the last high priority one
+std::atomic<uint32_t> lowBeforeLastHigh(0);
+
+class BlockEvent : public Event
+{
+public:
+    BlockEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 1;
+};
+
+class HighEvent : public Event
+{
+public:
+    HighEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 2;
+    constexpr static EventPriority priority = EventPriority::High;
+};
+
+class LowEvent : public Event
+{
+public:
+    LowEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 3;
+    constexpr static EventPriority priority = EventPriority::Low;
+};
+
+class LaneHandler : public EventReceiver
+{
+public:
+    LaneHandler()
+        : EventReceiver({
+            dispatchEvent<LaneHandler, BlockEvent, &LaneHandler::handleBlock>(),
+            dispatchEvent<LaneHandler, HighEvent, &LaneHandler::handleHigh>(),
+            dispatchEvent<LaneHandler, LowEvent, &LaneHandler::handleLow>(),
+        })
+    {}
+
+    HandleResult handleBlock(BlockEvent* event)
+    {
+        while (!released)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleHigh(HighEvent* event)
+    {
+        ++highHandled;
+        lowBeforeLastHigh = lowHandled.load();
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleLow(LowEvent* event)
+    {
+        ++lowHandled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Queues a burst of low then high priority events while delivery is stalled, then lets it go
+void runBurst(EventSystem& system, uint32_t numLow, uint32_t numHigh)
+{
+    released = false;
+    highHandled = 0;
+    lowHandled = 0;
+    lowBeforeLastHigh = 0;
+
+    system.queueEvent(BlockEvent());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (uint32_t i = 0; i < numLow; ++i)
+    {
+        system.queueEvent(LowEvent());
+    }
+    for (uint32_t i = 0; i < numHigh; ++i)
+    {
+        system.queueEvent(HighEvent());
+    }
+    released = true;
+
+    for (uint32_t i = 0; i < 100 && (lowHandled < numLow || highHandled < numHigh); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr);
+    LaneHandler handler;
+
+    // A single input queued behind a burst of snapshots is delivered first
+    runBurst(system, 100, 1);
+    if (highHandled != 1 || lowBeforeLastHigh != 0)
+    {
+        std::cout << "TEST FAILURE: High priority event was delivered after " << lowBeforeLastHigh << " low priority events\n";
+        return 1;
+    }
+
+    // Weighted draining still lets snapshots through while inputs keep coming
+    runBurst(system, 100, 100);
+    if (highHandled != 100 || lowHandled != 100 || lowBeforeLastHigh == 0)
+    {
+        std::cout << "TEST FAILURE: Weighted draining starved the low priority lane\n";
+        return 1;
+    }
+
+    // Strict draining empties the high priority lane first
+    system.setDrainPolicy(DrainPolicy::Strict);
+    runBurst(system, 100, 100);
+    if (highHandled != 100 || lowHandled != 100 || lowBeforeLastHigh != 0)
+    {
+        std::cout << "TEST FAILURE: Strict draining delivered " << lowBeforeLastHigh << " low priority events early\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Events were delivered in priority order\n";
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+#include "../common/Network.h"
+#include "../common/SimulationEvents.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/*
+ * Measures input-to-server latency over loopback: a client sends ThrottleEvents to a game
+ * master one at a time, and the time from queueing each until the game master handles it
+ * is recorded.
+ *
+ * The receive thread used to sleep 10 ms before each drain of RakNet's packets, so the
+ * median was around 5 ms. Now it blocks until a datagram arrives, so it should be far less.
+ */
+
+const uint32_t numInputs = 200;
+
+std::atomic<bool> connected(false);
+std::atomic<uint32_t> received(0);
+std::vector<std::chrono::steady_clock::time_point> sentAt(numInputs);
+std::vector<std::chrono::steady_clock::time_point> handledAt(numInputs);
+
+class ConnectionWatcher : public ReceiveInterface
+{
+public:
+    bool ConnectionEstablished(RakNet::RakNetGUID other) override
+    {
+        connected = true;
+        return true;
+    }
+};
+
+class InputHandler : public EventReceiver
+{
+public:
+    InputHandler(EventSystem* system)
+        : EventReceiver(system, {dispatchEvent<InputHandler, ThrottleEvent, &InputHandler::handleThrottle>()})
+    {}
+
+    HandleResult handleThrottle(ThrottleEvent* event)
+    {
+        if (event->desiredSpeed < numInputs)
+        {
+            handledAt[event->desiredSpeed] = std::chrono::steady_clock::now();
+        }
+        ++received;
+        return HandleResult::Stop;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::WARN);
+
+    // Not the usual port, so a running game master does not get in the way
+    const unsigned short port = NETWORK_SERVER_PORT + 1;
+
+    Network serverNetwork(true, port);
+    EventSystem server(&serverNetwork, false);
+    InputHandler handler(&server);
+
+    Network clientNetwork(false);
+    EventSystem client(&clientNetwork, false);
+    ConnectionWatcher watcher;
+    clientNetwork.registerCallback(&watcher);
+    clientNetwork.connect("127.0.0.1", port);
+
+    for (uint32_t i = 0; i < 500 && !connected; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!connected)
+    {
+        std::cout << "TEST FAILURE: Client could not connect over loopback\n";
+        return 1;
+    }
+
+    // One input at a time, at uneven intervals, so they land anywhere in a poll period
+    ThrottleEvent throttle;
+    throttle.team = throttle.unit = 0;
+    for (uint32_t i = 0; i < numInputs; ++i)
+    {
+        throttle.desiredSpeed = i;
+        sentAt[i] = std::chrono::steady_clock::now();
+        client.queueEvent(EnvelopeMessage(throttle));
+
+        for (uint32_t wait = 0; wait < 1000 && received <= i; ++wait)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (received <= i)
+        {
+            std::cout << "TEST FAILURE: Input " << i << " never reached the game master\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500 + (i * 7919) % 3000));
+    }
+
+    std::vector<double> latencies;
+    for (uint32_t i = 0; i < numInputs; ++i)
+    {
+        latencies.push_back(std::chrono::duration<double, std::milli>(handledAt[i] - sentAt[i]).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double median = latencies[latencies.size() / 2];
+    double worst = latencies.back();
+
+    clientNetwork.deregisterCallback(&watcher);
+
+    std::cout << "Input-to-server latency over " << numInputs << " inputs: median " << median
+        << " ms, 99th percentile " << latencies[latencies.size() * 99 / 100] << " ms, worst " << worst << " ms\n";
+
+    if (median >= 5.0)
+    {
+        std::cout << "TEST FAILURE: Median latency is no better than sleeping 10 ms between receives\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Inputs reached the game master without waiting for a poll\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+class SlowEvent : public Event
+{
+public:
+    SlowEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 1;
+
+    uint32_t sequence;
+};
+
+class FastEvent : public Event
+{
+public:
+    FastEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 2;
+};
+
+// Kept outside the receiver, since its handler may still be running while it is destroyed
+std::atomic<bool> released(false);
+std::atomic<uint32_t> slowHandled(0);
+std::vector<uint32_t> sequences;
+
+/// Mailbox receiver that blocks until released, like a station waiting on a redraw
+class SlowHandler : public EventReceiver
+{
+public:
+    SlowHandler()
+        : EventReceiver({dispatchEvent<SlowHandler, SlowEvent, &SlowHandler::handleSlow>()}, DeliveryMode::Mailbox)
+    {}
+
+    HandleResult handleSlow(SlowEvent* event)
+    {
+        while (!released)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        sequences.push_back(event->sequence);
+        ++slowHandled;
+        return HandleResult::Stop;
+    }
+};
+
+class FastHandler : public EventReceiver
+{
+public:
+    FastHandler()
+        : EventReceiver({dispatchEvent<FastHandler, FastEvent, &FastHandler::handleFast>()})
+        , handled(false)
+    {}
+
+    HandleResult handleFast(FastEvent* event)
+    {
+        handled = true;
+        return HandleResult::Stop;
+    }
+
+    std::atomic<bool> handled;
+};
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    const uint32_t numSlow = 200;
+
+    EventSystem system(nullptr);
+    std::unique_ptr<SlowHandler> slow(new SlowHandler);
+    FastHandler fast;
+
+    SlowEvent slowEvent;
+    for (uint32_t i = 0; i < numSlow; ++i)
+    {
+        slowEvent.sequence = i;
+        system.queueEvent(slowEvent);
+    }
+    system.queueEvent(FastEvent());
+
+    // The inline receiver must not be stuck behind the blocked mailbox receiver
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!fast.handled)
+    {
+        std::cout << "TEST FAILURE: Inline receiver was blocked by a mailbox receiver\n";
+        return 1;
+    }
+
+    released = true;
+    for (uint32_t i = 0; i < 100 && slowHandled < numSlow; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (slowHandled != numSlow)
+    {
+        std::cout << "TEST FAILURE: Mailbox receiver handled " << slowHandled << " of " << numSlow << " events\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < numSlow; ++i)
+    {
+        if (sequences[i] != i)
+        {
+            std::cout << "TEST FAILURE: Mailbox receiver saw event " << sequences[i] << " at position " << i << "\n";
+            return 1;
+        }
+    }
+
+    // Deregistering waits for the handler that is running, then drops the rest of the mailbox
+    released = false;
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        system.queueEvent(slowEvent);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread release([]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        released = true;
+    });
+    slow.reset();
+    release.join();
+    if (slowHandled != numSlow + 1)
+    {
+        std::cout << "TEST FAILURE: Expected one more event handled before deregistration, got "
+            << slowHandled - numSlow << "\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Mailbox delivery kept order without blocking inline receivers\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+class PayloadEvent : public Event
+{
+public:
+    PayloadEvent() : Event(category, id) {}
+    PayloadEvent(std::vector<uint32_t>&& values_)
+        : Event(category, id)
+        , values(std::move(values_))
+    {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 1;
+
+    std::vector<uint32_t> values;
+};
+
+// Storage the delivered payload is expected to still be in
+std::atomic<const uint32_t*> expected(nullptr);
+std::atomic<uint32_t> handled(0);
+std::atomic<uint32_t> moved(0);
+
+class PayloadHandler : public EventReceiver
+{
+public:
+    PayloadHandler()
+        : EventReceiver({dispatchEvent<PayloadHandler, PayloadEvent, &PayloadHandler::handlePayload>()})
+    {}
+
+    HandleResult handlePayload(PayloadEvent* event)
+    {
+        if (event->values.data() == expected.load())
+        {
+            ++moved;
+        }
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+/// Waits for the given number of events to have been handled
+bool waitForHandled(uint32_t count)
+{
+    for (uint32_t i = 0; i < 100 && handled < count; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return handled == count;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr);
+    PayloadHandler handler;
+
+    // A moved event keeps its storage all the way to the handler
+    PayloadEvent event;
+    event.values.assign(1000, 7);
+    expected = event.values.data();
+    system.queueEvent(std::move(event));
+    if (!waitForHandled(1) || moved != 1)
+    {
+        std::cout << "TEST FAILURE: queueEvent(T&&) copied the event payload\n";
+        return 1;
+    }
+
+    // The second time around, the event is moved into a recycled one
+    std::vector<uint32_t> values(1000, 7);
+    expected = values.data();
+    system.emplaceEvent<PayloadEvent>(std::move(values));
+    if (!waitForHandled(2) || moved != 2)
+    {
+        std::cout << "TEST FAILURE: emplaceEvent copied the event payload\n";
+        return 1;
+    }
+
+    // Copies are still made from lvalues
+    PayloadEvent kept;
+    kept.values.assign(1000, 7);
+    expected = kept.values.data();
+    system.queueEvent(kept);
+    if (!waitForHandled(3) || moved != 2 || kept.values.size() != 1000)
+    {
+        std::cout << "TEST FAILURE: queueEvent(const T&) did not copy the event\n";
+        return 1;
+    }
+
+    // Envelopes take ownership of moved events too
+    PayloadEvent wrapped;
+    wrapped.values.assign(1000, 7);
+    const uint32_t* storage = wrapped.values.data();
+    EnvelopeMessage envelope(std::move(wrapped));
+    if (static_cast<PayloadEvent*>(envelope.event.get())->values.data() != storage)
+    {
+        std::cout << "TEST FAILURE: EnvelopeMessage copied a moved event\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Moved and emplaced events were not copied\n";
+    return 0;
+}
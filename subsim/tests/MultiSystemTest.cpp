@@ -0,0 +1,85 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <iostream>
+
+class MatchEvent : public Event
+{
+public:
+    MatchEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = 1;
+
+    uint32_t match;
+};
+
+// Indexed by the match each receiver belongs to; kept outside the receivers like the other tests
+std::atomic<uint32_t> handled[2];
+std::atomic<uint32_t> misdelivered(0);
+
+class MatchHandler : public EventReceiver
+{
+public:
+    MatchHandler(EventSystem* system, uint32_t match_, DeliveryMode mode)
+        : EventReceiver(system, {dispatchEvent<MatchHandler, MatchEvent, &MatchHandler::handleMatch>()}, mode)
+        , match(match_)
+    {}
+
+    HandleResult handleMatch(MatchEvent* event)
+    {
+        if (event->match != match)
+        {
+            ++misdelivered;
+        }
+        ++handled[match];
+        return HandleResult::Stop;
+    }
+
+    uint32_t match;
+};
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    const uint32_t numEvents = 500;
+
+    EventSystem global(nullptr);
+    EventSystem local(nullptr, false);
+    if (EventSystem::getGlobalInstance() != &global)
+    {
+        std::cout << "TEST FAILURE: A non-global EventSystem replaced the global instance\n";
+        return 1;
+    }
+
+    // Receivers without an explicit EventSystem still register with the global one
+    MatchHandler first(nullptr, 0, DeliveryMode::Inline);
+    MatchHandler second(&local, 1, DeliveryMode::Mailbox);
+
+    MatchEvent event;
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+        event.match = 0;
+        global.queueEvent(event);
+        event.match = 1;
+        local.queueEvent(event);
+    }
+
+    for (uint32_t i = 0; i < 100 && (handled[0] < numEvents || handled[1] < numEvents); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (handled[0] != numEvents || handled[1] != numEvents || misdelivered != 0)
+    {
+        std::cout << "TEST FAILURE: Matches handled " << handled[0] << " and " << handled[1] << " of "
+            << numEvents << " events, " << misdelivered << " crossed over\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Independent EventSystems kept their events apart\n";
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "../common/Log.h"
+#include "../common/Network.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+/*
+ * Checks that Network callbacks can be deregistered, then destroyed, while the receive
+ * thread may be calling them: from another thread, deregisterCallback waits for the call
+ * to return, and from inside a callback, the rest of that dispatch skips the callback.
+ */
+
+/// Takes its time over each connection, as a lobby handler might
+class SlowWatcher : public ReceiveInterface
+{
+public:
+    SlowWatcher() : entered(false), finished(false) {}
+
+    bool ConnectionEstablished(RakNet::RakNetGUID other) override
+    {
+        entered = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        finished = true;
+        return true;
+    }
+
+    std::atomic<bool> entered;
+    std::atomic<bool> finished;
+};
+
+/// The first of a pair deregisters the second, as if destroying it, and passes the connection on
+class PairedWatcher : public ReceiveInterface
+{
+public:
+    PairedWatcher() : other(nullptr), calls(0), removed(false), calledAfterRemoval(false) {}
+
+    bool ConnectionEstablished(RakNet::RakNetGUID guid) override
+    {
+        if (removed)
+        {
+            calledAfterRemoval = true;
+        }
+        ++calls;
+        if (other)
+        {
+            network->deregisterCallback(other);
+            other->removed = true;
+        }
+        return false;
+    }
+
+    PairedWatcher* other;
+    std::atomic<uint32_t> calls;
+    std::atomic<bool> removed;
+    std::atomic<bool> calledAfterRemoval;
+};
+
+bool waitFor(const std::atomic<bool>& flag)
+{
+    for (uint32_t i = 0; i < 500 && !flag; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return flag;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    // Not the usual port, so a running game master does not get in the way
+    const unsigned short port = NETWORK_SERVER_PORT + 4;
+    Network server(true, port);
+
+    // Deregistering from another thread waits for the receive thread to leave the callback
+    SlowWatcher slow;
+    server.registerCallback(&slow);
+    Network firstClient(false);
+    firstClient.connect("127.0.0.1", port);
+    if (!waitFor(slow.entered))
+    {
+        std::cout << "TEST FAILURE: Client could not connect over loopback\n";
+        return 1;
+    }
+    server.deregisterCallback(&slow);
+    if (!slow.finished)
+    {
+        std::cout << "TEST FAILURE: deregisterCallback returned while the callback was still running\n";
+        return 1;
+    }
+
+    // Deregistering from inside a callback skips the removed callback for the rest of the dispatch.
+    // Sets are ordered by address, so the first of the array is called first
+    PairedWatcher pair[2];
+    pair[0].other = &pair[1];
+    server.registerCallback(&pair[0]);
+    server.registerCallback(&pair[1]);
+    Network secondClient(false);
+    secondClient.connect("127.0.0.1", port);
+    if (!waitFor(pair[1].removed))
+    {
+        std::cout << "TEST FAILURE: Second client could not connect over loopback\n";
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    server.deregisterCallback(&pair[0]);
+    if (pair[1].calledAfterRemoval || pair[1].calls != 0)
+    {
+        std::cout << "TEST FAILURE: A callback deregistered by another was still called\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Deregistered callbacks were not called once deregistration returned\n";
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+#include "../common/Network.h"
+#include "../common/SimulationEvents.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Checks each event type's delivery policy over a lossy loopback link: a client sends a
+ * game master inputs (ThrottleEvents) interleaved with snapshot acks (UnitStateAcks)
+ * while its RakNet drops a fifth of its datagrams.
+ *
+ * Every input must still arrive, in order, as inputs are reliable and ordered. Acks are
+ * unreliable and sequenced, so lost ones are not resent, and a late one never arrives
+ * after a newer one.
+ *
+ * RakNet only simulates loss in builds with its network simulator; elsewhere nothing is
+ * dropped and only the ordering is checked.
+ */
+
+const uint32_t numSent = 300;
+
+std::atomic<bool> connected(false);
+std::mutex receivedMux;
+std::vector<uint32_t> inputs;
+std::vector<uint32_t> acks;
+
+class ConnectionWatcher : public ReceiveInterface
+{
+public:
+    bool ConnectionEstablished(RakNet::RakNetGUID other) override
+    {
+        connected = true;
+        return true;
+    }
+};
+
+class GameMaster : public EventReceiver
+{
+public:
+    GameMaster(EventSystem* system)
+        : EventReceiver(system, {
+            dispatchEvent<GameMaster, ThrottleEvent, &GameMaster::handleThrottle>(),
+            dispatchEvent<GameMaster, UnitStateAck, &GameMaster::handleAck>()})
+    {}
+
+    HandleResult handleThrottle(ThrottleEvent* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        inputs.push_back(event->desiredSpeed);
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleAck(UnitStateAck* event)
+    {
+        std::lock_guard<std::mutex> lock(receivedMux);
+        acks.push_back(event->sequence);
+        return HandleResult::Stop;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::WARN);
+
+    // Not the usual port, so a running game master does not get in the way
+    const unsigned short port = NETWORK_SERVER_PORT + 2;
+
+    Network serverNetwork(true, port);
+    EventSystem server(&serverNetwork, false);
+    GameMaster gameMaster(&server);
+
+    Network clientNetwork(false);
+    EventSystem client(&clientNetwork, false);
+    ConnectionWatcher watcher;
+    clientNetwork.registerCallback(&watcher);
+    clientNetwork.connect("127.0.0.1", port);
+
+    for (uint32_t i = 0; i < 500 && !connected; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!connected)
+    {
+        std::cout << "TEST FAILURE: Client could not connect over loopback\n";
+        return 1;
+    }
+
+    clientNetwork.simulateLossyLink(0.2f, 5, 5);
+
+    ThrottleEvent throttle;
+    throttle.team = throttle.unit = 0;
+    UnitStateAck ack;
+    ack.team = ack.unit = 0;
+    for (uint32_t i = 0; i < numSent; ++i)
+    {
+        throttle.desiredSpeed = i;
+        client.queueEvent(EnvelopeMessage(throttle));
+        ack.sequence = i + 1;
+        client.queueEvent(EnvelopeMessage(ack));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Resent inputs can take several round trips
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(receivedMux);
+            if (inputs.size() >= numSent)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    clientNetwork.deregisterCallback(&watcher);
+
+    std::lock_guard<std::mutex> lock(receivedMux);
+    std::cout << inputs.size() << " of " << numSent << " inputs and " << acks.size() << " of " << numSent
+        << " acks arrived over a link dropping 20% of datagrams\n";
+
+    if (inputs.size() != numSent)
+    {
+        std::cout << "TEST FAILURE: Reliable inputs were lost\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < numSent; ++i)
+    {
+        if (inputs[i] != i)
+        {
+            std::cout << "TEST FAILURE: Input " << inputs[i] << " arrived in place of " << i << "\n";
+            return 1;
+        }
+    }
+
+    for (size_t i = 1; i < acks.size(); ++i)
+    {
+        if (acks[i] <= acks[i - 1])
+        {
+            std::cout << "TEST FAILURE: Ack " << acks[i] << " arrived after ack " << acks[i - 1] << "\n";
+            return 1;
+        }
+    }
+    if (acks.size() > numSent)
+    {
+        std::cout << "TEST FAILURE: Unreliable acks were duplicated\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Inputs survived packet loss in order, and snapshots were not resent\n";
+    return 0;
+}
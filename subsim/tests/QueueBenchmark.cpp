@@ -0,0 +1,139 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/EventQueue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Contention benchmark for the EventSystem backing queue. N producer threads
+ * each push their share of events while a single consumer drains them, like
+ * the network/sim/SDL/Arduino threads feeding the delivery thread.
+ *
+ * The lock-free EventQueue is compared against the previous mutex + deque +
+ * condition variable queue.
+ */
+
+class QueuedEvent : public Event
+{
+public:
+    QueuedEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 100;
+    constexpr static uint32_t id = 1;
+};
+
+/// The queue EventSystem used before the lock-free ring
+class MutexDequeQueue
+{
+public:
+    MutexDequeQueue() : closed(false) {}
+
+    void push(EventPtr&& event)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mux);
+            events.push_back(std::move(event));
+        }
+        signal.notify_one();
+    }
+
+    EventPtr pop()
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        if (events.empty())
+        {
+            return nullptr;
+        }
+        EventPtr result = std::move(events.front());
+        events.pop_front();
+        return result;
+    }
+
+    bool wait()
+    {
+        std::unique_lock<std::mutex> lock(mux);
+        signal.wait(lock, [this]{ return closed || !events.empty(); });
+        return !closed;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mux);
+        closed = true;
+        signal.notify_one();
+    }
+
+private:
+    std::deque<EventPtr> events;
+    std::mutex mux;
+    std::condition_variable signal;
+    bool closed;
+};
+
+/// Returns millions of events per second pushed through the queue
+template <typename Queue>
+double run(uint32_t producers, uint64_t totalEvents)
+{
+    Queue queue;
+    uint64_t perProducer = totalEvents / producers;
+    uint64_t expected = perProducer * producers;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&queue, expected]()
+    {
+        uint64_t received = 0;
+        while (received < expected && queue.wait())
+        {
+            while (EventPtr event = queue.pop())
+            {
+                ++received;
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&queue, perProducer]()
+        {
+            for (uint64_t j = 0; j < perProducer; ++j)
+            {
+                queue.push(EventPtr(new QueuedEvent));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    consumer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    queue.close();
+
+    return expected / seconds / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    const uint64_t totalEvents = 2000000;
+
+    std::cout << "producers | mutex+deque Mevents/s | lock-free EventQueue Mevents/s\n";
+    for (uint32_t producers : {1, 4, 16})
+    {
+        double baseline = run<MutexDequeQueue>(producers, totalEvents);
+        double lockFree = run<EventQueue>(producers, totalEvents);
+        std::cout << producers << " | " << baseline << " | " << lockFree
+            << " (" << lockFree / baseline << "x)\n";
+    }
+    return 0;
+}
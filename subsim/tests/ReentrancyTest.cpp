@@ -0,0 +1,195 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+template <uint32_t ID>
+class TestEvent : public Event
+{
+public:
+    TestEvent() : Event(category, id) {}
+    constexpr static uint32_t category = 1;
+    constexpr static uint32_t id = ID;
+};
+
+typedef TestEvent<1> BlockEvent;
+typedef TestEvent<2> SpawnEvent;
+typedef TestEvent<3> PingEvent;
+typedef TestEvent<4> QuitEvent;
+typedef TestEvent<5> DoneEvent;
+
+class Child;
+class MailboxChild;
+
+// Receivers are created and destroyed by handlers, so all state is kept out here
+std::atomic<bool> released(false);
+std::atomic<bool> done(false);
+std::atomic<uint32_t> pings(0);
+std::atomic<uint32_t> mailboxPings(0);
+std::atomic<bool> mailboxQuit(false);
+std::unique_ptr<Child> child;
+std::unique_ptr<MailboxChild> mailboxChild;
+
+/// Receiver that is destroyed from inside its own handler
+class Child : public EventReceiver
+{
+public:
+    Child()
+        : EventReceiver({
+            dispatchEvent<Child, PingEvent, &Child::handlePing>(),
+            dispatchEvent<Child, QuitEvent, &Child::handleQuit>(),
+        })
+    {}
+
+    HandleResult handlePing(PingEvent* event)
+    {
+        ++pings;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleQuit(QuitEvent* event)
+    {
+        child.reset();
+        return HandleResult::Stop;
+    }
+};
+
+/// Mailbox receiver that is destroyed from inside its own handler, on a worker thread
+class MailboxChild : public EventReceiver
+{
+public:
+    MailboxChild()
+        : EventReceiver({
+            dispatchEvent<MailboxChild, PingEvent, &MailboxChild::handlePing>(),
+            dispatchEvent<MailboxChild, QuitEvent, &MailboxChild::handleQuit>(),
+        }, DeliveryMode::Mailbox)
+    {}
+
+    HandleResult handlePing(PingEvent* event)
+    {
+        ++mailboxPings;
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleQuit(QuitEvent* event)
+    {
+        mailboxChild.reset();
+        mailboxQuit = true;
+        return HandleResult::Stop;
+    }
+};
+
+/// Receiver that creates a Child from inside a handler
+class Spawner : public EventReceiver
+{
+public:
+    Spawner()
+        : EventReceiver({
+            dispatchEvent<Spawner, BlockEvent, &Spawner::handleBlock>(),
+            dispatchEvent<Spawner, SpawnEvent, &Spawner::handleSpawn>(),
+            dispatchEvent<Spawner, DoneEvent, &Spawner::handleDone>(),
+        })
+    {}
+
+    HandleResult handleBlock(BlockEvent* event)
+    {
+        while (!released)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleSpawn(SpawnEvent* event)
+    {
+        child.reset(new Child);
+        return HandleResult::Stop;
+    }
+
+    HandleResult handleDone(DoneEvent* event)
+    {
+        done = true;
+        return HandleResult::Stop;
+    }
+};
+
+/// Waits for the delivery thread to get through everything queued so far
+bool waitForDone(EventSystem& system)
+{
+    done = false;
+    system.queueEvent(DoneEvent());
+    for (uint32_t i = 0; i < 100 && !done; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return done;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    const uint32_t numPings = 10;
+
+    EventSystem system(nullptr);
+    Spawner spawner;
+
+    // Registering from a handler must not deadlock, and takes effect for later events
+    system.queueEvent(SpawnEvent());
+    if (!waitForDone(system))
+    {
+        std::cout << "TEST FAILURE: Delivery stalled after registering from a handler\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < numPings; ++i)
+    {
+        system.queueEvent(PingEvent());
+    }
+    if (!waitForDone(system) || pings != numPings)
+    {
+        std::cout << "TEST FAILURE: Receiver registered from a handler got " << pings << " of " << numPings << " events\n";
+        return 1;
+    }
+
+    // A receiver destroying itself is skipped for the rest of the pass it was in
+    system.queueEvent(BlockEvent());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    system.queueEvent(QuitEvent());
+    for (uint32_t i = 0; i < numPings; ++i)
+    {
+        system.queueEvent(PingEvent());
+    }
+    released = true;
+    if (!waitForDone(system) || child || pings != numPings)
+    {
+        std::cout << "TEST FAILURE: Receiver destroyed from its own handler got " << pings - numPings << " more events\n";
+        return 1;
+    }
+
+    // Mailbox receivers can do the same from a worker thread
+    mailboxChild.reset(new MailboxChild);
+    system.queueEvent(QuitEvent());
+    for (uint32_t i = 0; i < numPings; ++i)
+    {
+        system.queueEvent(PingEvent());
+    }
+    for (uint32_t i = 0; i < 100 && !mailboxQuit; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    waitForDone(system);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (!mailboxQuit || mailboxPings != 0)
+    {
+        std::cout << "TEST FAILURE: Mailbox receiver destroyed from its own handler got " << mailboxPings << " more events\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Receivers were registered and destroyed from inside handlers\n";
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "../common/Log.h"
+#include "../common/ConfigParser.h"
+#include "../common/EventCodec.h"
+#include "../common/GenericParser.h"
+#include "../common/SimulationEvents.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Compares the size of a SonarDisplayState on every six player map, sent with the
+ * quantized encoding against the previous one (full 64 bit x/y/depth and 16 bit headings).
+ *
+ * Each state holds six subs at their start locations, two torpedos per sub, and the map's
+ * mines and flags, which is about what a busy tick carries.
+ *
+ * Run from the game_master directory, as the configs load their maps relative to it.
+ */
+
+/// The fields SonarDisplayState sent before positions were quantized
+struct LegacyPosition
+{
+    int64_t x, y, depth;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        visit(self.x, self.y, self.depth);
+    }
+};
+
+struct LegacySonar
+{
+    const SonarDisplayState& sonar;
+
+    template <typename Self, typename Visitor>
+    static void fields(Self& self, Visitor& visit)
+    {
+        LegacyPosition position{0, 0, 0};
+        uint32_t count = 0;
+
+        visit(count);
+        for (const UnitSonarState& unit : self.sonar.units)
+        {
+            visit(unit.team, unit.unit, position, unit.heading, unit.speed, unit.power,
+                unit.hasFlag, unit.isStealth, unit.stealthCooldown, unit.respawning, unit.respawnCooldown);
+        }
+        visit(count);
+        for (const TorpedoState& torpedo : self.sonar.torpedos)
+        {
+            visit(position, torpedo.heading);
+        }
+        visit(count);
+        for (size_t i = 0; i < self.sonar.mines.size(); ++i)
+        {
+            visit(position);
+        }
+        visit(count);
+        for (const FlagState& flag : self.sonar.flags)
+        {
+            visit(flag.team, position, flag.isTaken);
+        }
+    }
+};
+
+SonarDisplayState makeSonarState(const Config& config)
+{
+    SonarDisplayState sonar;
+    sonar.mapWidth = config.terrain.width * config.terrain.scale;
+    sonar.mapHeight = config.terrain.height * config.terrain.scale;
+
+    uint32_t count = 0;
+    for (auto& team : config.startLocations)
+    {
+        for (uint32_t i = 0; i < team.second.size() && count < 6; ++i, ++count)
+        {
+            UnitSonarState unit;
+            unit.team = team.first;
+            unit.unit = i;
+            unit.x = team.second[i].first;
+            unit.y = team.second[i].second;
+            unit.heading = (count * 67) % 360;
+            unit.speed = config.subMaxSpeed;
+            unit.power = 100;
+            unit.hasFlag = false;
+            unit.isStealth = false;
+            unit.stealthCooldown = 0;
+            unit.respawning = false;
+            unit.respawnCooldown = 0;
+            sonar.units.push_back(unit);
+
+            for (int32_t spread : {-1, 1})
+            {
+                uint16_t heading = (unit.heading + 360 + spread * config.torpedoSpread) % 360;
+                TorpedoState torpedo;
+                torpedo.x = unit.x + 1.5 * config.collisionRadius * cos(heading * 2*M_PI/360.0);
+                torpedo.y = unit.y + 1.5 * config.collisionRadius * sin(heading * 2*M_PI/360.0);
+                torpedo.heading = heading;
+                sonar.torpedos.push_back(torpedo);
+            }
+        }
+    }
+    for (auto& mine : config.mines)
+    {
+        sonar.mines.push_back(MineState{mine.first, mine.second});
+    }
+    for (auto& team : config.flags)
+    {
+        for (auto& flag : team.second)
+        {
+            sonar.flags.push_back(FlagState{team.first, flag.first, flag.second, false});
+        }
+    }
+    return sonar;
+}
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::setLogLevel(Log::ERR);
+
+    const std::vector<std::string> maps = {"arrows", "asymmetric1", "asymmetric2", "caverns",
+        "clover", "minefield", "symmetric", "training"};
+
+    std::cout << "map | entities | legacy bytes | quantized bytes\n";
+    for (const std::string& map : maps)
+    {
+        Config config = ConfigParser::parseConfig(GenericParser::parse("data/six_player/" + map + ".cfg"));
+        SonarDisplayState sonar = makeSonarState(config);
+
+        FieldSizer legacy;
+        legacy(LegacySonar{sonar});
+        size_t quantized = estimateEventBits<SonarDisplayState>(sonar);
+
+        std::cout << map << " | "
+            << sonar.units.size() + sonar.torpedos.size() + sonar.mines.size() + sonar.flags.size() << " | "
+            << (legacy.bits + 7) / 8 << " | " << (quantized + 7) / 8
+            << " (" << (double)legacy.bits / quantized << "x smaller)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "../common/Log.h"
+#include "../common/EventSystem.h"
+#include "../common/Messages.h"
+#include "../common/SimulationEvents.h"
+#include "../common/TerrainCache.h"
+
+#include "BitStream.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+std::atomic<uint32_t> handled(0);
+TerrainData received;
+
+class TerrainHandler : public EventReceiver
+{
+public:
+    TerrainHandler(EventSystem* system)
+        : EventReceiver(system, {dispatchEvent<TerrainHandler, TerrainData, &TerrainHandler::handleTerrain>()})
+    {}
+
+    HandleResult handleTerrain(TerrainData* event)
+    {
+        received = *event;
+        ++handled;
+        return HandleResult::Stop;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Log::setLogfile(std::string(argv[0]) + ".log");
+    Log::clearLog();
+    Log::shouldMirrorToConsole(true);
+    Log::setLogLevel(Log::ALL);
+
+    EventSystem system(nullptr, false);
+    TerrainHandler handler(&system);
+
+    Terrain terrain;
+    terrain.width = 20;
+    terrain.height = 10;
+    terrain.scale = 1000;
+    terrain.map.resize(200, uint32_t(Terrain::EMPTY));
+    for (uint32_t i = 0; i < 200; i += 3)
+    {
+        terrain.map[i] = Terrain::WALL;
+    }
+    terrain.map[1] = Terrain::FLAG1;
+
+    // The hash only covers what is sent: the flag pixel is sent (and hashed) as empty space
+    uint64_t hash = terrainHash(terrain);
+    Terrain sent = terrain;
+    sent.map[1] = Terrain::EMPTY;
+    if (hash == 0 || terrainHash(sent) != hash)
+    {
+        std::cout << "TEST FAILURE: Terrain hash depends on more than the walls\n";
+        return 1;
+    }
+    sent.map[2] = Terrain::WALL;
+    if (terrainHash(sent) == hash)
+    {
+        std::cout << "TEST FAILURE: Moving a wall did not change the terrain hash\n";
+        return 1;
+    }
+
+    // A miss, then a hit once the terrain has been stored
+    TerrainCache cache(".");
+    std::remove(cache.path(hash).c_str());
+    Terrain loaded;
+    if (cache.load(hash, loaded))
+    {
+        std::cout << "TEST FAILURE: Terrain was loaded before it was cached\n";
+        return 1;
+    }
+    cache.store(terrain);
+    if (!cache.load(hash, loaded) || loaded.width != 20 || loaded.height != 10 || loaded.scale != 1000
+        || loaded.map[0] != Terrain::WALL || loaded.map[1] != Terrain::EMPTY || terrainHash(loaded) != hash)
+    {
+        std::cout << "TEST FAILURE: Cached terrain did not load back\n";
+        return 1;
+    }
+
+    // A damaged cache file is a miss, not an error
+    {
+        std::ofstream file(cache.path(hash), std::ios::binary | std::ios::trunc);
+        file << "not a terrain";
+    }
+    if (cache.load(hash, loaded))
+    {
+        std::cout << "TEST FAILURE: Damaged cache file was loaded\n";
+        return 1;
+    }
+    std::remove(cache.path(hash).c_str());
+
+    // On a miss, the terrain is fetched with a TerrainData event
+    TerrainData data;
+    data.hash = hash;
+    data.terrain = terrain;
+    RakNet::BitStream stream;
+    if (!EnvelopeMessage::serializeEvent(data, stream)
+        || !EnvelopeMessage::deserializeEvent(data.i_category, data.i_id, stream, &system))
+    {
+        std::cout << "TEST FAILURE: TerrainData has no codec\n";
+        return 1;
+    }
+    for (uint32_t i = 0; i < 100 && handled < 1; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (handled != 1 || received.hash != hash || terrainHash(received.terrain) != hash)
+    {
+        std::cout << "TEST FAILURE: TerrainData did not survive the round trip\n";
+        return 1;
+    }
+
+    // Until then the client renders with the config's terrain, sent with its size but no cells
+    ConfigEvent config;
+    config.config.terrain = terrain;
+    config.config.terrain.map.clear();
+    config.terrainHash = hash;
+    stream.Reset();
+    EnvelopeMessage::serializeEvent(config, stream);
+    ConfigEvent missed;
+    FieldReader reader(stream);
+    ConfigEvent::fields(missed, reader);
+    if (missed.config.terrain.width != 20 || missed.config.terrain.height != 10 || !missed.config.terrain.map.empty())
+    {
+        std::cout << "TEST FAILURE: Config did not arrive with an empty terrain of the right size\n";
+        return 1;
+    }
+
+    // As TacticalStation::renderSDTerrain does, over the whole map and a margin around it
+    for (int32_t tx = -2; tx < 22; ++tx)
+    {
+        for (int32_t ty = -2; ty < 12; ++ty)
+        {
+            bool inside = tx >= 0 && tx < 20 && ty >= 0 && ty < 10;
+            uint32_t expected = inside ? Terrain::EMPTY : Terrain::WALL;
+            if (missed.config.terrain.colorAt(tx, ty) != expected)
+            {
+                std::cout << "TEST FAILURE: Terrain without cells rendered something other than open water at ("
+                    << tx << ", " << ty << ")\n";
+                return 1;
+            }
+        }
+    }
+
+    missed.config.terrain = received.terrain;
+    if (missed.config.terrain.colorAt(0, 9) != Terrain::WALL || missed.config.terrain.colorAt(1, 9) != Terrain::EMPTY)
+    {
+        std::cout << "TEST FAILURE: Fetched terrain did not render its walls\n";
+        return 1;
+    }
+
+    std::cout << "TEST SUCCESS: Terrains were cached by content hash\n";
+    return 0;
+}